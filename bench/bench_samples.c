@@ -0,0 +1,51 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "bench_samples.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void samples_add(bench_samples_t *samples, uint64_t value) {
+    if (samples->count == samples->capacity) {
+        samples->capacity = samples->capacity ? samples->capacity * 2 : 256;
+        samples->samples  = realloc(samples->samples, samples->capacity * sizeof(uint64_t));
+    }
+    samples->samples[samples->count++] = value;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t lhs = *(const uint64_t *)a;
+    uint64_t rhs = *(const uint64_t *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+void samples_report(const char *name, const char *unit, bench_samples_t *samples) {
+    if (samples->count == 0) {
+        printf("  %-18s no samples\n", name);
+        return;
+    }
+    qsort(samples->samples, samples->count, sizeof(uint64_t), compare_u64);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < samples->count; i++) {
+        sum += samples->samples[i];
+    }
+    printf("  %-18s n=%-8zu mean=%-8.1f p50=%-6" PRIu64 " p99=%-6" PRIu64 " max=%-6" PRIu64
+           " %s\n",
+           name, samples->count, (double)sum / samples->count,
+           samples->samples[samples->count / 2], samples->samples[samples->count * 99 / 100],
+           samples->samples[samples->count - 1], unit);
+}
+
+void samples_free(bench_samples_t *samples) {
+    free(samples->samples);
+    *samples = (bench_samples_t){0};
+}
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,31 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * \file
+ *
+ * Timing samples shared by the host benchmarks: collect values, then print their percentiles.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t *samples;
+    size_t    count;
+    size_t    capacity;
+} bench_samples_t;
+
+/** \brief Appends a value, growing the buffer as needed. */
+void samples_add(bench_samples_t *samples, uint64_t value);
+
+/** \brief Sorts the samples and prints their count, mean, median, p99 and max in `unit`. */
+void samples_report(const char *name, const char *unit, bench_samples_t *samples);
+
+/** \brief Frees the samples and empties the set. */
+void samples_free(bench_samples_t *samples);
+
+/** \brief Monotonic wall clock in nanoseconds. */
+uint64_t now_ns(void);
@@ -0,0 +1,387 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * \file
+ *
+ * Replays recorded key event traces through features/leader_compose.c on the host.
+ *
+ * A trace holds one event per line, either the `KL:` line printed by `process_leader_compose()`
+ * on the console, so `qmk console` output replays as-is, or the short form
+ *
+ *     <time ms> <down|up> <keycode name or 0xNNNN> [<row> <col>]
+ *
+ * The position is only needed with `LEADER_COMPOSE_MATCH_POSITION`. Lines starting with `#` are
+ * ignored. Between events the scan loop is simulated by calling `leader_compose_task()` once per
+ * virtual millisecond, like `matrix_scan_user()` does.
+ *
+ * Every action holds its sequence until the last key is released, like `leader_lock_ctrl()`, and
+ *
+ *     <time ms> expect held <count>
+ *
+ * checks how many sequences are held at that time, the bench fails when one does not match.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_samples.h"
+#include "leader_compose.h"
+#include "leader_compose_trie.h"
+#include "timer.h"
+
+#ifndef LEADER_TIMEOUT
+#    define LEADER_TIMEOUT 300
+#endif
+
+#define BENCH_SCAN_INTERVAL_MS 1
+
+typedef enum {
+    BENCH_KEY,
+    BENCH_EXPECT_HELD,
+} bench_event_kind_t;
+
+typedef struct {
+    uint32_t time;
+    uint16_t keycode;
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+    uint8_t  kind;
+    uint8_t  held;
+} bench_event_t;
+
+static uint32_t bench_now = 0;
+static unsigned bench_replay = 0;
+
+static bench_samples_t process_ns  = {0};
+static bench_samples_t task_ns     = {0};
+static bench_samples_t decision_ms = {0};
+
+static uint32_t last_key_time   = 0;
+static uint32_t decided_time    = UINT32_MAX;
+static uint32_t actions_fired   = 0;
+static uint32_t retractions     = 0;
+static uint32_t no_matches      = 0;
+static uint32_t early_finishes  = 0;
+static uint32_t timeout_endings = 0;
+static uint32_t failed_expects  = 0;
+
+// Sequences the actions hold, in the order they were registered
+static leader_compose_packed_t held_sequences[8];
+static uint8_t                 held_count = 0;
+
+uint16_t timer_read(void) {
+    return bench_now;
+}
+
+uint32_t timer_read32(void) {
+    return bench_now;
+}
+
+// Packs the keys leading to the trie node bound to `action` into `sequence`
+static bool sequence_of(uint16_t node, uint16_t action, uint8_t depth,
+                        leader_compose_packed_t *sequence) {
+    if (node != LEADER_COMPOSE_ROOT_NODE) {
+        *sequence |= (leader_compose_packed_t)leader_compose_trie[node].key << (8 * (depth - 1));
+        if (leader_compose_trie[node].action == action) {
+            return true;
+        }
+    }
+    uint16_t first = leader_compose_trie[node].first_child;
+    for (uint16_t child = first; child < first + leader_compose_trie[node].child_count; child++) {
+        if (sequence_of(child, action, depth + 1, sequence)) {
+            return true;
+        }
+    }
+    if (node != LEADER_COMPOSE_ROOT_NODE) {
+        *sequence &= ~((leader_compose_packed_t)0xFF << (8 * (depth - 1)));
+    }
+    return false;
+}
+
+// Sequence of the action at the same index as `function` in `table`, 0 if there is none
+static leader_compose_packed_t action_sequence(const leader_compose_action_t *table,
+                                               leader_compose_action_t        function) {
+    leader_compose_packed_t sequence = 0;
+    for (uint16_t i = 0; i < LEADER_COMPOSE_ACTION_COUNT; i++) {
+        if (table[i] == function) {
+            sequence_of(LEADER_COMPOSE_ROOT_NODE, i, 0, &sequence);
+            break;
+        }
+    }
+    return sequence;
+}
+
+static void hold(leader_compose_packed_t sequence) {
+    if (held_count < sizeof(held_sequences) / sizeof(held_sequences[0]) &&
+        leader_compose_hold_sequence(sequence)) {
+        held_sequences[held_count++] = sequence;
+    }
+}
+
+static void release(leader_compose_packed_t sequence) {
+    if (!leader_compose_release_held_sequence(sequence)) {
+        return;
+    }
+    for (uint8_t i = 0; i < held_count; i++) {
+        if (held_sequences[i] == sequence) {
+            held_sequences[i] = held_sequences[--held_count];
+            return;
+        }
+    }
+}
+
+#define BENCH_ACTION(action)                                        \
+    void action(void) {                                             \
+        actions_fired++;                                            \
+        decided_time = bench_now;                                   \
+        hold(action_sequence(leader_compose_actions, action));      \
+    }
+LEADER_COMPOSE_ACTIONS(BENCH_ACTION)
+#undef BENCH_ACTION
+
+#ifdef LEADER_COMPOSE_SPECULATIVE
+#    define BENCH_UNDO(undo)                                        \
+    void undo(void) {                                               \
+        actions_fired--;                                            \
+        retractions++;                                              \
+        release(action_sequence(leader_compose_undos, undo));       \
+    }
+LEADER_COMPOSE_UNDOS(BENCH_UNDO)
+#    undef BENCH_UNDO
+#endif
+
+// Key of the event being replayed, the keycode alone does not tell positions apart
+static uint8_t replayed_key = 0;
+
+void leader_compose_on_key_release_user(uint16_t keycode) {
+    uint8_t key = replayed_key;
+    for (uint8_t i = held_count; i-- > 0;) {
+        leader_compose_packed_t sequence = held_sequences[i];
+        uint8_t                 last     = 0;
+        for (leader_compose_packed_t keys = sequence; keys; keys >>= 8) {
+            last = keys;
+        }
+        if (last == key) {
+            release(sequence);
+        }
+    }
+}
+
+void leader_compose_start_user(void) {
+    decided_time = UINT32_MAX;
+}
+
+void leader_compose_on_no_match_user(void) {
+    no_matches++;
+}
+
+void leader_compose_end_user(void) {
+    if (leader_compose_sequence_timed_out()) {
+        timeout_endings++;
+    } else {
+        early_finishes++;
+    }
+    // A speculated action decided the sequence when it fired, not when the sequence ended
+    if (leader_compose_sequence_packed() != 0) {
+        uint32_t decided = decided_time < bench_now ? decided_time : bench_now;
+        samples_add(&decision_ms, decided > last_key_time ? decided - last_key_time : 0);
+    }
+}
+
+static void scan_once(void) {
+    uint64_t start = now_ns();
+    leader_compose_task();
+    samples_add(&task_ns, now_ns() - start);
+}
+
+static void scan_until(uint32_t time) {
+    while (bench_now + BENCH_SCAN_INTERVAL_MS <= time) {
+        bench_now += BENCH_SCAN_INTERVAL_MS;
+        scan_once();
+    }
+    bench_now = time;
+}
+
+static void replay_event(const bench_event_t *event) {
+    keyrecord_t record   = {0};
+    record.event.pressed = event->pressed;
+    record.event.time    = event->time;
+    record.event.key.row = event->row;
+    record.event.key.col = event->col;
+    record.keycode       = event->keycode;
+
+    replayed_key       = leader_compose_record_key(event->keycode, &record);
+    uint64_t start     = now_ns();
+    bool     continues = process_leader_compose(event->keycode, &record);
+    samples_add(&process_ns, now_ns() - start);
+
+    if (event->pressed && !continues) {
+        last_key_time = bench_now;
+    }
+}
+
+static bool parse_keycode(const char *token, uint16_t *keycode) {
+    static const struct {
+        const char *name;
+        uint16_t    value;
+    } names[] = {
+#define BENCH_KEYCODE_NAME(name, value) {#name, value},
+        BENCH_KEYCODES(BENCH_KEYCODE_NAME)
+#undef BENCH_KEYCODE_NAME
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(token, names[i].name) == 0) {
+            *keycode = names[i].value;
+            return true;
+        }
+    }
+    char         *end   = NULL;
+    unsigned long value = strtoul(token, &end, 0);
+    if (end == token || *end != '\0' || value > UINT16_MAX) {
+        return false;
+    }
+    *keycode = value;
+    return true;
+}
+
+static bool parse_event(const char *line, bench_event_t *event) {
+    unsigned keycode, col, row, pressed, time;
+    if (sscanf(line, "KL: kc: 0x%X, col: %u, row: %u, pressed: %u, time: %u", &keycode, &col,
+               &row, &pressed, &time) == 5) {
+        event->keycode = keycode;
+        event->row     = row;
+        event->col     = col;
+        event->pressed = pressed;
+        event->time    = time;
+        event->kind    = BENCH_KEY;
+        return true;
+    }
+
+    unsigned held;
+    if (sscanf(line, "%u expect held %u", &time, &held) == 2) {
+        event->time = time;
+        event->held = held;
+        event->kind = BENCH_EXPECT_HELD;
+        return true;
+    }
+
+    char action[8], key[32];
+    int  fields = sscanf(line, "%u %7s %31s %u %u", &time, action, key, &row, &col);
+    if (fields < 3 || !parse_keycode(key, &event->keycode)) {
+        return false;
+    }
+    if (fields != 5) {
+#ifdef LEADER_COMPOSE_MATCH_POSITION
+        // Matching by position needs the real one, row 0 col 0 is a key like any other
+        return false;
+#endif
+        row = col = 0;
+    }
+    event->time    = time;
+    event->row     = row;
+    event->col     = col;
+    event->pressed = strcmp(action, "down") == 0;
+    event->kind    = BENCH_KEY;
+    return event->pressed || strcmp(action, "up") == 0;
+}
+
+static bench_event_t *load_trace(const char *path, size_t *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    bench_event_t *events   = NULL;
+    size_t         capacity = 0;
+    char           line[256];
+    unsigned       lineno = 0;
+    *count                = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            events   = realloc(events, capacity * sizeof(bench_event_t));
+        }
+        if (!parse_event(line, &events[*count])) {
+            fprintf(stderr, "%s:%u: cannot parse event: %s", path, lineno, line);
+            exit(1);
+        }
+        (*count)++;
+    }
+    fclose(file);
+    return events;
+}
+
+static void replay_trace(const bench_event_t *events, size_t count) {
+    // Console timestamps are 16-bit and wrap, replay them on a monotonic clock
+    uint32_t offset = bench_now;
+    uint16_t last   = count ? events[0].time : 0;
+    for (size_t i = 0; i < count; i++) {
+        offset += (uint16_t)(events[i].time - last);
+        last = events[i].time;
+        scan_until(offset);
+        if (events[i].kind == BENCH_EXPECT_HELD) {
+            if (held_count != events[i].held && failed_expects++ < 10) {
+                fprintf(stderr, "replay %u at %" PRIu32 " ms: %u sequences held, expected %u\n",
+                        bench_replay, events[i].time, held_count, events[i].held);
+            }
+            continue;
+        }
+        replay_event(&events[i]);
+        scan_once();
+    }
+    scan_until(bench_now + 4 * LEADER_TIMEOUT);
+}
+
+int main(int argc, char **argv) {
+    unsigned repeat = 100;
+    int      first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        repeat = strtoul(argv[2], NULL, 0);
+        first  = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-n repeat] trace...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = first; i < argc; i++) {
+        size_t         count  = 0;
+        bench_event_t *events = load_trace(argv[i], &count);
+
+        actions_fired = no_matches = early_finishes = timeout_endings = retractions = 0;
+
+        for (bench_replay = 0; bench_replay < repeat; bench_replay++) {
+            replay_trace(events, count);
+        }
+
+        printf("%s: %zu events x %u\n", argv[i], count, repeat);
+        samples_report("process_leader", "ns", &process_ns);
+        samples_report("leader_task/scan", "ns", &task_ns);
+        samples_report("decision latency", "ms", &decision_ms);
+        // Per replay, speculation is learned across replays so retractions are fractional
+        printf("  sequences          actions=%" PRIu32 " no-match=%" PRIu32 " early=%" PRIu32
+               " timeout=%" PRIu32 " retracted=%.2f\n",
+               actions_fired / repeat, no_matches / repeat, early_finishes / repeat,
+               timeout_endings / repeat, (double)retractions / repeat);
+
+        samples_free(&process_ns);
+        samples_free(&task_ns);
+        samples_free(&decision_ms);
+        free(events);
+    }
+    if (failed_expects) {
+        fprintf(stderr, "%" PRIu32 " expectations failed\n", failed_expects);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,451 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * \file
+ *
+ * Steps features/rgb_control.c and features/rgb_scheduler.c through scripted scenarios on a
+ * virtual clock and compares the LED buffer of every frame to the golden frames stored next to the
+ * scenario.
+ *
+ * A scenario holds one command per line, `<time ms>` being virtual time:
+ *
+ *     <time> enable <led> <rrggbb> <interval> <n times|forever>
+ *     <time> mask <hex led mask> <rrggbb> <interval> <n times|forever>
+ *     <time> disable <led>
+ *     <time> clear
+ *     <time> mode <rgb matrix mode>
+ *     <time> sleep <ms>
+ *     <time> schedule
+ *     <time> activity
+ *     <time> end
+ *
+ * Lines starting with `#` are ignored. Frames are rendered every GOLDEN_FRAME_MS from the first
+ * command until `end`, like rgb_matrix_indicators_user followed by rgb_control_flush. Any mode but
+ * 0 (RGB_MATRIX_NONE) stands for an effect painting every LED before the indicators. `sleep` renders
+ * no frame for a while, like a suspended keyboard or a matrix toggled off.
+ *
+ * `schedule` hands the frames to rgb_scheduler_render for the rest of the scenario, with the idle
+ * timeout counting from there, and `activity` stands for a key event. The effect is dimmed by the
+ * brightness the scheduler sets.
+ *
+ * The golden file lists, for each frame that changed the LED buffer, the frame time and the LEDs
+ * that changed as `<led>=<rrggbb>`. With -g the golden files are written instead of compared.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_samples.h"
+#include "info_config.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+#include "rgb_scheduler.h"
+#include "timer.h"
+
+#define GOLDEN_FRAME_MS 16
+// What an effect paints under the indicators
+#define GOLDEN_EFFECT_COLOR 0x10, 0x10, 0x10
+
+typedef enum {
+    GOLDEN_ENABLE,
+    GOLDEN_MASK,
+    GOLDEN_DISABLE,
+    GOLDEN_CLEAR,
+    GOLDEN_MODE,
+    GOLDEN_SLEEP,
+    GOLDEN_SCHEDULE,
+    GOLDEN_ACTIVITY,
+    GOLDEN_END,
+} golden_action_t;
+
+typedef struct {
+    uint32_t        time;
+    golden_action_t action;
+    uint64_t        leds;
+    RGB             color;
+    uint16_t        interval;
+    uint16_t        n_times;
+} golden_command_t;
+
+static uint32_t golden_now  = 0;
+static uint8_t  golden_mode = RGB_MATRIX_NONE;
+static uint8_t  golden_val  = UINT8_MAX;
+static bool     scheduled   = false;
+
+static RGB      frame[RGB_MATRIX_LED_COUNT];
+static RGB      previous_frame[RGB_MATRIX_LED_COUNT];
+static uint32_t set_color_calls = 0;
+
+static bench_samples_t calls_per_frame = {0};
+static bench_samples_t frame_ns        = {0};
+
+uint16_t timer_read(void) {
+    return golden_now;
+}
+
+uint32_t timer_read32(void) {
+    return golden_now;
+}
+
+uint8_t rgb_matrix_get_mode(void) {
+    return golden_mode;
+}
+
+bool rgb_matrix_is_enabled(void) {
+    return true;
+}
+
+uint8_t rgb_matrix_get_hue(void) {
+    return 0;
+}
+
+uint8_t rgb_matrix_get_sat(void) {
+    return 0;
+}
+
+uint8_t rgb_matrix_get_val(void) {
+    return golden_val;
+}
+
+void rgb_matrix_sethsv_noeeprom(uint16_t hue, uint8_t sat, uint8_t val) {
+    golden_val = val;
+}
+
+void rgb_matrix_set_color_all(uint8_t red, uint8_t green, uint8_t blue) {
+    for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        rgb_matrix_set_color(i, red, green, blue);
+    }
+}
+
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {
+    frame[index] = (RGB){red, green, blue};
+    set_color_calls++;
+}
+
+static bool parse_color(const char *token, RGB *color) {
+    char         *end   = NULL;
+    unsigned long value = strtoul(token, &end, 16);
+    if (end == token || *end != '\0' || value > 0xFFFFFF) {
+        return false;
+    }
+    *color = (RGB){value >> 16, (value >> 8) & 0xFF, value & 0xFF};
+    return true;
+}
+
+static bool parse_n_times(const char *token, uint16_t *n_times) {
+    if (strcmp(token, "forever") == 0) {
+        *n_times = RGB_BLINK_FOREVER;
+        return true;
+    }
+    char         *end   = NULL;
+    unsigned long value = strtoul(token, &end, 0);
+    if (end == token || *end != '\0' || value >= RGB_BLINK_FOREVER) {
+        return false;
+    }
+    *n_times = value;
+    return true;
+}
+
+static bool parse_command(const char *line, golden_command_t *command) {
+    char               action[16], target[32], color[16], n_times[16];
+    unsigned long long leds;
+    unsigned           interval;
+    int                fields = sscanf(line, "%" SCNu32 " %15s %31s %15s %u %15s", &command->time,
+                                       action, target, color, &interval, n_times);
+    if (fields < 2) {
+        return false;
+    }
+
+    if (strcmp(action, "enable") == 0 || strcmp(action, "mask") == 0) {
+        bool single     = strcmp(action, "enable") == 0;
+        command->action = single ? GOLDEN_ENABLE : GOLDEN_MASK;
+        if (fields != 6 || !parse_color(color, &command->color) ||
+            !parse_n_times(n_times, &command->n_times) || interval > INT16_MAX) {
+            return false;
+        }
+        command->interval = interval;
+        leds              = strtoull(target, NULL, single ? 10 : 16);
+        if (single && leds >= RGB_MATRIX_LED_COUNT) {
+            return false;
+        }
+        command->leds = single ? 1ULL << leds : leds;
+        return true;
+    } else if (strcmp(action, "disable") == 0) {
+        command->action = GOLDEN_DISABLE;
+        leds            = strtoull(target, NULL, 10);
+        command->leds   = leds;
+        return fields == 3 && leds < RGB_MATRIX_LED_COUNT;
+    } else if (strcmp(action, "mode") == 0) {
+        command->action = GOLDEN_MODE;
+        command->leds   = strtoull(target, NULL, 10);
+        return fields == 3;
+    } else if (strcmp(action, "sleep") == 0) {
+        command->action = GOLDEN_SLEEP;
+        command->leds   = strtoull(target, NULL, 10);
+        return fields == 3;
+    } else if (strcmp(action, "schedule") == 0) {
+        command->action = GOLDEN_SCHEDULE;
+        return fields == 2;
+    } else if (strcmp(action, "activity") == 0) {
+        command->action = GOLDEN_ACTIVITY;
+        return fields == 2;
+    } else if (strcmp(action, "clear") == 0) {
+        command->action = GOLDEN_CLEAR;
+        return fields == 2;
+    } else if (strcmp(action, "end") == 0) {
+        command->action = GOLDEN_END;
+        return fields == 2;
+    }
+    return false;
+}
+
+static golden_command_t *load_scenario(const char *path, size_t *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    golden_command_t *commands = NULL;
+    size_t            capacity = 0;
+    char              line[256];
+    unsigned          lineno = 0;
+    *count                   = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            commands = realloc(commands, capacity * sizeof(golden_command_t));
+        }
+        if (!parse_command(line, &commands[*count]) ||
+            (*count && commands[*count].time < commands[*count - 1].time)) {
+            fprintf(stderr, "%s:%u: cannot parse command: %s", path, lineno, line);
+            exit(1);
+        }
+        (*count)++;
+    }
+    fclose(file);
+
+    if (*count == 0 || commands[*count - 1].action != GOLDEN_END) {
+        fprintf(stderr, "%s: scenarios finish with an end command\n", path);
+        exit(1);
+    }
+    return commands;
+}
+
+static void run_command(const golden_command_t *command) {
+    switch (command->action) {
+        case GOLDEN_ENABLE:
+            enable_blinking_for(__builtin_ctzll(command->leds), command->color, command->interval,
+                                command->n_times);
+            break;
+        case GOLDEN_MASK:
+            enable_blinking_for_mask(command->leds, command->color, command->interval,
+                                     command->n_times);
+            break;
+        case GOLDEN_DISABLE:
+            disable_blinking_for(command->leds);
+            break;
+        case GOLDEN_CLEAR:
+            disable_all();
+            break;
+        case GOLDEN_MODE:
+            golden_mode = command->leds;
+            break;
+        case GOLDEN_SLEEP:
+            // The commands that fall in the sleep run when it is over
+            golden_now += command->leds;
+            break;
+        case GOLDEN_SCHEDULE:
+            scheduled = true;
+            rgb_scheduler_activity();
+            break;
+        case GOLDEN_ACTIVITY:
+            rgb_scheduler_activity();
+            break;
+        case GOLDEN_END:
+            break;
+    }
+}
+
+static void render_frame(FILE *out) {
+    if (golden_mode != RGB_MATRIX_NONE) {
+        RGB effect = {GOLDEN_EFFECT_COLOR};
+        for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+            frame[i] = (RGB){effect.r * golden_val / UINT8_MAX, effect.g * golden_val / UINT8_MAX,
+                             effect.b * golden_val / UINT8_MAX};
+        }
+    }
+
+    set_color_calls = 0;
+    uint64_t start  = now_ns();
+    if (!scheduled || rgb_scheduler_render()) {
+        manage_blinking_keys();
+        rgb_control_flush();
+    }
+    samples_add(&frame_ns, now_ns() - start);
+    samples_add(&calls_per_frame, set_color_calls);
+
+    bool changed = false;
+    for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        RGB now = frame[i], before = previous_frame[i];
+        if (now.r == before.r && now.g == before.g && now.b == before.b) {
+            continue;
+        }
+        if (!changed) {
+            fprintf(out, "%" PRIu32, golden_now);
+            changed = true;
+        }
+        fprintf(out, " %zu=%02x%02x%02x", i, now.r, now.g, now.b);
+        previous_frame[i] = now;
+    }
+    if (changed) {
+        fputc('\n', out);
+    }
+}
+
+static void replay_scenario(const golden_command_t *commands, size_t count, FILE *out) {
+    golden_now  = commands[0].time;
+    golden_mode = RGB_MATRIX_NONE;
+    scheduled   = false;
+    // Wakes up from the idle frame a previous scenario ended in
+    rgb_scheduler_activity();
+    memset(frame, 0, sizeof(frame));
+    memset(previous_frame, 0, sizeof(previous_frame));
+    disable_all();
+    rgb_control_invalidate();
+
+    size_t next = 0;
+    for (;;) {
+        while (next < count && commands[next].time <= golden_now) {
+            if (commands[next].action == GOLDEN_END) {
+                return;
+            }
+            run_command(&commands[next++]);
+        }
+        render_frame(out);
+        golden_now += GOLDEN_FRAME_MS;
+    }
+}
+
+static char *golden_path(const char *scenario) {
+    const char *dot    = strrchr(scenario, '.');
+    size_t      length = dot ? (size_t)(dot - scenario) : strlen(scenario);
+    char       *path   = malloc(length + sizeof(".golden"));
+    memcpy(path, scenario, length);
+    strcpy(path + length, ".golden");
+    return path;
+}
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return NULL;
+    }
+    char  *content  = NULL;
+    size_t capacity = 0;
+    *size           = 0;
+    for (;;) {
+        if (*size == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            content  = realloc(content, capacity);
+        }
+        size_t read = fread(content + *size, 1, capacity - *size, file);
+        if (read == 0) {
+            break;
+        }
+        *size += read;
+    }
+    fclose(file);
+    return content;
+}
+
+static int line_length(const char *text, size_t size, size_t start) {
+    const char *end = memchr(text + start, '\n', size - start);
+    return end ? end - (text + start) : (int)(size - start);
+}
+
+// Reports the first line that differs, golden and rendered frames are newline separated
+static bool compare_frames(const char *path, const char *expected, size_t expected_size,
+                           const char *rendered, size_t rendered_size) {
+    if (expected_size == rendered_size && memcmp(expected, rendered, rendered_size) == 0) {
+        return true;
+    }
+    size_t line = 1, start = 0;
+    for (size_t i = 0; i < expected_size && i < rendered_size && expected[i] == rendered[i]; i++) {
+        if (expected[i] == '\n') {
+            line++;
+            start = i + 1;
+        }
+    }
+    fprintf(stderr, "%s:%zu: frames differ\n  expected: %.*s\n  rendered: %.*s\n", path, line,
+            line_length(expected, expected_size, start), expected + start,
+            line_length(rendered, rendered_size, start), rendered + start);
+    return false;
+}
+
+int main(int argc, char **argv) {
+    bool write_golden = false;
+    int  first        = 1;
+    if (argc > 1 && strcmp(argv[1], "-g") == 0) {
+        write_golden = true;
+        first        = 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-g] scenario...\n", argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        size_t            count    = 0;
+        golden_command_t *commands = load_scenario(argv[i], &count);
+        char             *path     = golden_path(argv[i]);
+
+        char  *rendered      = NULL;
+        size_t rendered_size = 0;
+        FILE  *out           = open_memstream(&rendered, &rendered_size);
+        replay_scenario(commands, count, out);
+        fclose(out);
+
+        const char *result = "ok";
+        if (write_golden) {
+            FILE *golden = fopen(path, "w");
+            if (!golden || fwrite(rendered, 1, rendered_size, golden) != rendered_size) {
+                perror(path);
+                return 1;
+            }
+            fclose(golden);
+            result = "written";
+        } else {
+            size_t expected_size = 0;
+            char  *expected      = read_file(path, &expected_size);
+            if (!expected) {
+                perror(path);
+                result = "FAILED";
+                failures++;
+            } else if (!compare_frames(path, expected, expected_size, rendered, rendered_size)) {
+                result = "FAILED";
+                failures++;
+            }
+            free(expected);
+        }
+
+        printf("%s: %zu frames, %s\n", argv[i], frame_ns.count, result);
+        samples_report("set_color/frame", "calls", &calls_per_frame);
+        samples_report("frame", "ns", &frame_ns);
+
+        samples_free(&calls_per_frame);
+        samples_free(&frame_ns);
+        free(rendered);
+        free(path);
+        free(commands);
+    }
+    return failures ? 1 : 0;
+}
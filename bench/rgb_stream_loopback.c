@@ -0,0 +1,142 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * \file
+ *
+ * Stands in for the keyboard behind /dev/hidraw so features/rgb_stream.py can be tried without
+ * one. Reads 32-byte raw HID reports from stdin, hands them to features/rgb_stream.c and writes
+ * the replies to stdout, like the hidraw node would. Built with RGB_COMPOSITOR_ENABLE the stream
+ * paints the host plane of features/rgb_compositor.c, without it the rgb_control frame directly.
+ *
+ * After every report a frame is rendered, and each LED the frame changed is printed to stderr as
+ * `<report> <led>=<rrggbb>`.
+ *
+ * Given a stream file instead, it reads one report per line as hex, zero padded to 32 bytes, and
+ * prints the replies as `<report> reply <command> <status>` along with the LEDs to stdout, which
+ * `make stream` compares to the golden output next to the file. Lines starting with `#` are
+ * ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "info_config.h"
+#include "raw_hid.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+#include "rgb_stream.h"
+#ifdef RGB_COMPOSITOR_ENABLE
+#    include "rgb_compositor.h"
+#endif
+
+#define REPORT_SIZE 32
+
+static RGB      leds[RGB_MATRIX_LED_COUNT];
+static unsigned report_count;
+// Where the LEDs are printed, and whether the replies are printed there too instead of sent
+static FILE *output  = NULL;
+static bool  scripted = false;
+
+uint16_t timer_read(void) {
+    return 0;
+}
+
+uint32_t timer_read32(void) {
+    return 0;
+}
+
+uint8_t rgb_matrix_get_mode(void) {
+    return RGB_MATRIX_NONE;
+}
+
+bool rgb_matrix_is_enabled(void) {
+    return true;
+}
+
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {
+    RGB *led = &leds[index];
+    if (led->r != red || led->g != green || led->b != blue) {
+        fprintf(output, "%u %d=%02x%02x%02x\n", report_count, index, red, green, blue);
+    }
+    *led = (RGB){.r = red, .g = green, .b = blue};
+}
+
+void raw_hid_send(uint8_t *data, uint8_t length) {
+    if (scripted) {
+        fprintf(output, "%u reply %02x %u\n", report_count, data[0], data[1]);
+        return;
+    }
+    fwrite(data, 1, length, stdout);
+    fflush(stdout);
+}
+
+static void receive(uint8_t *report) {
+    report_count++;
+    if (!rgb_stream_receive(report, REPORT_SIZE)) {
+        fprintf(output, "%u: not an rgb_stream command 0x%02x\n", report_count, report[0]);
+        // The keyboard answers nothing, the client would time out
+        return;
+    }
+    manage_rgb_stream();
+#ifdef RGB_COMPOSITOR_ENABLE
+    rgb_compositor_compose();
+#endif
+    rgb_control_flush();
+}
+
+// Parses one line of hex bytes, spaces allowed between them
+static bool parse_report(const char *line, uint8_t *report) {
+    size_t length = 0;
+    memset(report, 0, REPORT_SIZE);
+    for (const char *c = line; *c && *c != '\n';) {
+        if (*c == ' ' || *c == '\t' || *c == '\r') {
+            c++;
+            continue;
+        }
+        unsigned byte;
+        if (length == REPORT_SIZE || sscanf(c, "%2x", &byte) != 1 || !c[1] || c[1] == ' ') {
+            return false;
+        }
+        report[length++] = byte;
+        c += 2;
+    }
+    return length > 0;
+}
+
+int main(int argc, char **argv) {
+    uint8_t report[REPORT_SIZE];
+    output = stderr;
+    // Nothing painted yet, the first flush only reports what the stream lit
+    rgb_control_flush();
+    if (argc < 2) {
+        while (fread(report, 1, sizeof(report), stdin) == sizeof(report)) {
+            receive(report);
+        }
+        return 0;
+    }
+
+    FILE *file = fopen(argv[1], "r");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+    output   = stdout;
+    scripted = true;
+    char     line[256];
+    unsigned lineno = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (!parse_report(line, report)) {
+            fprintf(stderr, "%s:%u: cannot parse report: %s", argv[1], lineno, line);
+            return 1;
+        }
+        receive(report);
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,36 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/action.h, only the key record types used by features/.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "keycodes.h"
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef struct {
+    keypos_t key;
+    bool     pressed;
+    uint16_t time;
+    uint8_t  type;
+} keyevent_t;
+
+typedef struct {
+    bool    interrupted : 1;
+    bool    reserved2 : 1;
+    bool    reserved1 : 1;
+    bool    reserved0 : 1;
+    uint8_t count : 4;
+} tap_t;
+
+typedef struct {
+    keyevent_t event;
+    tap_t      tap;
+    uint16_t   keycode;
+} keyrecord_t;
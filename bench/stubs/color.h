@@ -0,0 +1,23 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/color.h, only the RGB type and the named colors.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} RGB;
+
+#define RGB_OFF    0x00, 0x00, 0x00
+#define RGB_WHITE  0xFF, 0xFF, 0xFF
+#define RGB_RED    0xFF, 0x00, 0x00
+#define RGB_YELLOW 0xFF, 0xFF, 0x00
+#define RGB_GREEN  0x00, 0xFF, 0x00
+#define RGB_CYAN   0x00, 0xFF, 0xFF
+#define RGB_BLUE   0x00, 0x00, 0xFF
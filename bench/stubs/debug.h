@@ -0,0 +1,11 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/logging/debug.h, debug output is compiled out like without
+// CONSOLE_ENABLE so it does not skew the timings.
+
+#pragma once
+
+#define dprint(s)          ((void)0)
+#define dprintln(s)        ((void)0)
+#define dprintf(fmt, ...)  ((void)0)
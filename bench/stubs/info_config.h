@@ -0,0 +1,8 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for the generated info_config.h of zsa/voyager.
+
+#pragma once
+
+#define RGB_MATRIX_LED_COUNT 52
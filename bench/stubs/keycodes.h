@@ -0,0 +1,44 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/keycodes.h with the keycodes used by traces and sequences. Values
+// match QMK so recorded console traces replay as-is.
+
+#pragma once
+
+// clang-format off
+#define BENCH_KEYCODES(X) \
+    X(KC_NO, 0x0000) \
+    X(KC_A, 0x0004) X(KC_B, 0x0005) X(KC_C, 0x0006) X(KC_D, 0x0007) X(KC_E, 0x0008) \
+    X(KC_F, 0x0009) X(KC_G, 0x000A) X(KC_H, 0x000B) X(KC_I, 0x000C) X(KC_J, 0x000D) \
+    X(KC_K, 0x000E) X(KC_L, 0x000F) X(KC_M, 0x0010) X(KC_N, 0x0011) X(KC_O, 0x0012) \
+    X(KC_P, 0x0013) X(KC_Q, 0x0014) X(KC_R, 0x0015) X(KC_S, 0x0016) X(KC_T, 0x0017) \
+    X(KC_U, 0x0018) X(KC_V, 0x0019) X(KC_W, 0x001A) X(KC_X, 0x001B) X(KC_Y, 0x001C) \
+    X(KC_Z, 0x001D) X(KC_1, 0x001E) X(KC_2, 0x001F) X(KC_3, 0x0020) X(KC_4, 0x0021) \
+    X(KC_5, 0x0022) X(KC_6, 0x0023) X(KC_7, 0x0024) X(KC_8, 0x0025) X(KC_9, 0x0026) \
+    X(KC_0, 0x0027) X(KC_ENTER, 0x0028) X(KC_ESCAPE, 0x0029) X(KC_BACKSPACE, 0x002A) \
+    X(KC_TAB, 0x002B) X(KC_SPACE, 0x002C) X(KC_MINUS, 0x002D) X(KC_EQUAL, 0x002E) \
+    X(KC_SEMICOLON, 0x0033) X(KC_COMMA, 0x0036) X(KC_DOT, 0x0037) X(KC_SLASH, 0x0038) \
+    X(KC_LEFT_CTRL, 0x00E0) X(KC_LEFT_SHIFT, 0x00E1) X(KC_LEFT_ALT, 0x00E2) \
+    X(KC_LEFT_GUI, 0x00E3) \
+    X(QK_LEADER, 0x7C58)
+// clang-format on
+
+#define BENCH_KEYCODE_ENUM(name, value) name = value,
+enum bench_keycodes { BENCH_KEYCODES(BENCH_KEYCODE_ENUM) };
+#undef BENCH_KEYCODE_ENUM
+
+#define KC_SPC  KC_SPACE
+#define KC_ENT  KC_ENTER
+#define KC_ESC  KC_ESCAPE
+#define KC_BSPC KC_BACKSPACE
+#define QK_LEAD QK_LEADER
+
+#define QK_MOD_TAP                      0x2000
+#define QK_MOD_TAP_MAX                  0x3FFF
+#define QK_LAYER_TAP                    0x4000
+#define QK_LAYER_TAP_MAX                0x4FFF
+#define IS_QK_MOD_TAP(code)             ((code) >= QK_MOD_TAP && (code) <= QK_MOD_TAP_MAX)
+#define IS_QK_LAYER_TAP(code)           ((code) >= QK_LAYER_TAP && (code) <= QK_LAYER_TAP_MAX)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(kc)  ((kc)&0xFF)
+#define QK_LAYER_TAP_GET_TAP_KEYCODE(kc) ((kc)&0xFF)
@@ -0,0 +1,14 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for platforms/progmem.h, flash is plain memory like on ARM.
+
+#pragma once
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+#define pgm_read_word(address)  (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define pgm_read_ptr(address)   (*(void *const *)(address))
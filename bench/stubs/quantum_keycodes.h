@@ -0,0 +1,8 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/quantum_keycodes.h, everything needed lives in keycodes.h.
+
+#pragma once
+
+#include "keycodes.h"
@@ -0,0 +1,10 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/raw_hid.h, the host tools decide where replies go.
+
+#pragma once
+
+#include <stdint.h>
+
+void raw_hid_send(uint8_t *data, uint8_t length);
@@ -0,0 +1,22 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/rgb_matrix/rgb_matrix.h, the host tools capture what is painted.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "color.h"
+
+#define RGB_MATRIX_NONE        0
+#define RGB_MATRIX_SOLID_COLOR 1
+
+uint8_t rgb_matrix_get_mode(void);
+bool    rgb_matrix_is_enabled(void);
+void    rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue);
+void    rgb_matrix_set_color_all(uint8_t red, uint8_t green, uint8_t blue);
+uint8_t rgb_matrix_get_hue(void);
+uint8_t rgb_matrix_get_sat(void);
+uint8_t rgb_matrix_get_val(void);
+void    rgb_matrix_sethsv_noeeprom(uint16_t hue, uint8_t sat, uint8_t val);
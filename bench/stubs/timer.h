@@ -0,0 +1,16 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for platforms/timer.h, driven by the virtual clock of the host tools.
+
+#pragma once
+
+#include <stdint.h>
+
+uint16_t timer_read(void);
+uint32_t timer_read32(void);
+
+#define TIMER_DIFF_16(a, b) (uint16_t)((a) - (b))
+#define TIMER_DIFF_32(a, b) (uint32_t)((a) - (b))
+#define timer_elapsed(t)    TIMER_DIFF_16(timer_read(), (t))
+#define timer_elapsed32(t)  TIMER_DIFF_32(timer_read32(), (t))
@@ -0,0 +1,8 @@
+// Copyright 2023 QMK
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for quantum/util.h.
+
+#pragma once
+
+#define ARRAY_SIZE(array) (sizeof((array)) / sizeof((array)[0]))
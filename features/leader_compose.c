@@ -7,71 +7,457 @@
 #include "timer.h"
 #include "util.h"
 #include "quantum_keycodes.h"
-#include <string.h>
 
 #ifndef LEADER_TIMEOUT
 #    define LEADER_TIMEOUT 300
 #endif
 
-#ifndef LEADER_SEQUENCE_SIZE
-#    define LEADER_SEQUENCE_SIZE 5
+#ifndef LEADER_COMPOSE_HELD_SLOTS
+#    define LEADER_COMPOSE_HELD_SLOTS 4
+#endif
+
+_Static_assert(LEADER_COMPOSE_HELD_SLOTS <= 8, "LEADER_COMPOSE_HELD_SLOTS must fit a uint8_t mask");
+
+#ifdef LEADER_COMPOSE_MATCH_POSITION
+_Static_assert(MATRIX_COLS <= 16 &&
+                   LEADER_COMPOSE_KEYPOS(MATRIX_ROWS - 1, MATRIX_COLS - 1) < LEADER_COMPOSE_KEY_OTHER,
+               "LEADER_COMPOSE_MATCH_POSITION needs every key position to fit a byte");
+#endif
+
+#define LEADER_COMPOSE_HASH_SEED  2166136261UL
+#define LEADER_COMPOSE_HASH_PRIME 16777619UL
+
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+#    ifndef LEADER_PER_KEY_TIMING
+#        error "LEADER_COMPOSE_ADAPTIVE_TIMEOUT needs LEADER_PER_KEY_TIMING"
+#    endif
+#    ifndef LEADER_COMPOSE_ADAPTIVE_SLOTS
+#        define LEADER_COMPOSE_ADAPTIVE_SLOTS 16
+#    endif
+#    ifndef LEADER_COMPOSE_ADAPTIVE_MIN_SAMPLES
+#        define LEADER_COMPOSE_ADAPTIVE_MIN_SAMPLES 8
+#    endif
+#    ifndef LEADER_COMPOSE_ADAPTIVE_MIN_TIMEOUT
+#        define LEADER_COMPOSE_ADAPTIVE_MIN_TIMEOUT 50
+#    endif
+#    ifndef LEADER_COMPOSE_ADAPTIVE_MARGIN
+#        define LEADER_COMPOSE_ADAPTIVE_MARGIN 20
+#    endif
+#    ifndef LEADER_COMPOSE_ADAPTIVE_SAVE_INTERVAL
+#        define LEADER_COMPOSE_ADAPTIVE_SAVE_INTERVAL 64
+#    endif
+// EMA weight of a new interval is 1 / 2^LEADER_COMPOSE_ADAPTIVE_SHIFT
+#    define LEADER_COMPOSE_ADAPTIVE_SHIFT 3
+// Means are kept in 1/16 ms
+#    define LEADER_COMPOSE_ADAPTIVE_FRACTION 4
+#    define LEADER_COMPOSE_ADAPTIVE_MAGIC    0x4C43
+
+_Static_assert((LEADER_COMPOSE_ADAPTIVE_SLOTS & (LEADER_COMPOSE_ADAPTIVE_SLOTS - 1)) == 0,
+               "LEADER_COMPOSE_ADAPTIVE_SLOTS must be a power of two");
+
+/**
+ * Inter-key rhythm after one sequence prefix, `tag` is the upper half of the prefix hash.
+ */
+typedef struct {
+    uint16_t tag;
+    uint16_t mean;
+    uint16_t variance;
+    uint16_t timeout;
+    uint8_t  samples;
+} leader_compose_rhythm_t;
+
+typedef struct {
+    uint16_t                magic;
+    leader_compose_rhythm_t rhythm[LEADER_COMPOSE_ADAPTIVE_SLOTS];
+} leader_compose_adaptive_t;
+
+leader_compose_adaptive_t leader_compose_adaptive = {0};
+uint16_t                  leader_compose_timeout  = LEADER_TIMEOUT;
+// Prefix the last sequence timed out on while it could still be extended, dead otherwise
+uint16_t leader_compose_late_node = LEADER_COMPOSE_DEAD_NODE;
+uint32_t leader_compose_late_hash = 0;
+
+#    ifdef LEADER_COMPOSE_ADAPTIVE_PERSIST
+#        include <string.h>
+#        include "eeconfig.h"
+
+_Static_assert(sizeof(leader_compose_adaptive_t) <= EECONFIG_USER_DATA_SIZE,
+               "EECONFIG_USER_DATA_SIZE is too small for the leader_compose rhythm model");
+
+bool    leader_compose_adaptive_loaded  = false;
+uint8_t leader_compose_adaptive_updates = 0;
+#    endif
+#endif
+
+#ifdef LEADER_COMPOSE_SPECULATIVE
+#    ifndef LEADER_COMPOSE_SPECULATIVE_THRESHOLD
+#        define LEADER_COMPOSE_SPECULATIVE_THRESHOLD 8
+#    endif
+#    define LEADER_COMPOSE_SPECULATIVE_MAX 15
+// A wrong guess costs this much on top of the decay of a sequence ending elsewhere, so only
+// completions taken about three times out of four keep being speculated
+#    define LEADER_COMPOSE_SPECULATIVE_MISS_PENALTY 2
+
+_Static_assert(LEADER_COMPOSE_SPECULATIVE_THRESHOLD <= LEADER_COMPOSE_SPECULATIVE_MAX,
+               "LEADER_COMPOSE_SPECULATIVE_THRESHOLD can never be reached");
+
+// Node whose action was fired ahead of time, dead while nothing is speculated
+uint16_t leader_compose_speculated  = LEADER_COMPOSE_DEAD_NODE;
+uint16_t leader_compose_prefix_node = LEADER_COMPOSE_ROOT_NODE;
+// Set while a speculated action runs, is retracted, or a key release is forwarded to the user
+bool leader_compose_speculating = false;
+bool leader_compose_retracting  = false;
+bool leader_compose_releasing   = false;
+// Held slots a speculated action registered, releasing their key does nothing until the sequence
+// ends, as the action would only have run then
+uint8_t leader_compose_held_pending = 0;
 #endif
 
 // Leader key stuff
-bool     leading                                               = false;
-uint16_t leader_compose_time                                   = 0;
-uint16_t leader_compose_sequence[LEADER_SEQUENCE_SIZE]         = {0, 0, 0, 0, 0};
-uint8_t  leader_compose_sequence_size                          = 0;
-bool     leader_compose_down                                   = false;
-uint16_t leader_compose_sequence_held[2][LEADER_SEQUENCE_SIZE] = {0};
+bool                    leading                      = false;
+uint16_t                leader_compose_time          = 0;
+leader_compose_packed_t leader_compose_sequence      = 0;
+uint32_t                leader_compose_hash          = LEADER_COMPOSE_HASH_SEED;
+uint8_t                 leader_compose_sequence_size = 0;
+bool                    leader_compose_down          = false;
+uint16_t                leader_compose_node          = LEADER_COMPOSE_ROOT_NODE;
+
+// Held sequences, a slot is free when its bit in the used mask is clear
+leader_compose_packed_t leader_compose_sequence_held[LEADER_COMPOSE_HELD_SLOTS]    = {0};
+uint8_t                 leader_compose_held_release_key[LEADER_COMPOSE_HELD_SLOTS] = {0};
+uint8_t                 leader_compose_held_used                                   = 0;
+// One bit per compressed key, set while releasing that key can release a held sequence
+uint32_t leader_compose_held_release_keys[256 / 32] = {0};
+
+// Provided by the keymap, see features/leader_compose_trie.py
+extern const leader_compose_node_t   leader_compose_trie[];
+extern const leader_compose_action_t leader_compose_actions[];
+#ifdef LEADER_COMPOSE_SPECULATIVE
+extern const leader_compose_action_t leader_compose_undos[];
+extern uint8_t                       leader_compose_confidence[];
+#endif
 
 __attribute__((weak)) void leader_compose_start_user(void) {}
 
 __attribute__((weak)) void leader_compose_end_user(void) {}
 
-__attribute__((weak)) bool leader_compose_final_sequences(void) {
-    return false;
+__attribute__((weak)) void leader_compose_on_key_release_user(uint16_t keycode) {}
+__attribute__((weak)) void leader_compose_on_no_match_user(void) {}
+
+static uint16_t leader_compose_trie_child(uint16_t node, uint8_t key) {
+    if (node == LEADER_COMPOSE_DEAD_NODE) {
+        return LEADER_COMPOSE_DEAD_NODE;
+    }
+    uint16_t first_child = pgm_read_word(&leader_compose_trie[node].first_child);
+    uint8_t  child_count = pgm_read_byte(&leader_compose_trie[node].child_count);
+    for (uint16_t child = first_child; child < first_child + child_count; child++) {
+        if (pgm_read_byte(&leader_compose_trie[child].key) == key) {
+            return child;
+        }
+    }
+    return LEADER_COMPOSE_DEAD_NODE;
 }
 
-__attribute__((weak)) void leader_compose_on_key_release_user(uint16_t keycode) {}
-__attribute__((weak)) void leader_compose_on_timeout_sequences(void) {}
+static bool leader_compose_trie_run(uint16_t node) {
+    if (node == LEADER_COMPOSE_DEAD_NODE) {
+        return false;
+    }
+    uint16_t action = pgm_read_word(&leader_compose_trie[node].action);
+    if (action == LEADER_COMPOSE_NO_ACTION) {
+        return false;
+    }
+    ((leader_compose_action_t)pgm_read_ptr(&leader_compose_actions[action]))();
+    return true;
+}
+
+#ifdef LEADER_COMPOSE_SPECULATIVE
+static leader_compose_action_t leader_compose_trie_undo(uint16_t node) {
+    uint16_t action = pgm_read_word(&leader_compose_trie[node].action);
+    if (action == LEADER_COMPOSE_NO_ACTION) {
+        return NULL;
+    }
+    return (leader_compose_action_t)pgm_read_ptr(&leader_compose_undos[action]);
+}
+
+/**
+ * Picks the completion to fire early for the live prefix `node`, either `node` itself or one of
+ * its children. Only a confident guess without a close rival that can be undone is taken.
+ */
+static uint16_t leader_compose_speculation_pick(uint16_t node) {
+    uint16_t first_child = pgm_read_word(&leader_compose_trie[node].first_child);
+    uint8_t  child_count = pgm_read_byte(&leader_compose_trie[node].child_count);
+    uint16_t best        = node;
+    uint8_t  rival       = 0;
+    for (uint16_t child = first_child; child < first_child + child_count; child++) {
+        if (leader_compose_confidence[child] > leader_compose_confidence[best]) {
+            rival = leader_compose_confidence[best];
+            best  = child;
+        } else if (leader_compose_confidence[child] > rival) {
+            rival = leader_compose_confidence[child];
+        }
+    }
+
+    if (leader_compose_confidence[best] < LEADER_COMPOSE_SPECULATIVE_THRESHOLD ||
+        rival >= LEADER_COMPOSE_SPECULATIVE_THRESHOLD / 2 || !leader_compose_trie_undo(best)) {
+        return LEADER_COMPOSE_DEAD_NODE;
+    }
+    return best;
+}
+
+static void leader_compose_speculation_retract(void) {
+    dprintf("Retracting speculated node %u\n", leader_compose_speculated);
+    leader_compose_retracting = true;
+    leader_compose_trie_undo(leader_compose_speculated)();
+    leader_compose_retracting = false;
+    uint8_t *confidence = &leader_compose_confidence[leader_compose_speculated];
+    *confidence = *confidence > LEADER_COMPOSE_SPECULATIVE_MISS_PENALTY
+                      ? *confidence - LEADER_COMPOSE_SPECULATIVE_MISS_PENALTY
+                      : 0;
+    leader_compose_speculated = LEADER_COMPOSE_DEAD_NODE;
+}
+
+/**
+ * Called once the buffer moved to a new node, retracts a guess the new key disproved and fires
+ * the likely completion of the new prefix, if there is one.
+ */
+static void leader_compose_speculate(void) {
+    if (leader_compose_speculated != LEADER_COMPOSE_DEAD_NODE &&
+        leader_compose_speculated != leader_compose_node) {
+        leader_compose_speculation_retract();
+    }
+    if (leader_compose_speculated != LEADER_COMPOSE_DEAD_NODE ||
+        leader_compose_sequence_resolved()) {
+        return;
+    }
+    leader_compose_speculated = leader_compose_speculation_pick(leader_compose_node);
+    if (leader_compose_speculated != LEADER_COMPOSE_DEAD_NODE) {
+        dprintf("Speculating node %u\n", leader_compose_speculated);
+        leader_compose_speculating = true;
+        leader_compose_trie_run(leader_compose_speculated);
+        leader_compose_speculating = false;
+    }
+}
+
+static void leader_compose_confidence_decay(uint16_t first, uint16_t count, uint16_t except) {
+    for (uint16_t node = first; node < first + count; node++) {
+        if (node != except && leader_compose_confidence[node] > 0) {
+            leader_compose_confidence[node]--;
+        }
+    }
+}
+
+static void leader_compose_held_arm_pending(void);
+
+/**
+ * Settles the speculation once the sequence ended. The matched node gains confidence over the
+ * other ways its prefix could have ended, returns true when its action already ran.
+ */
+static bool leader_compose_speculation_settle(void) {
+    uint16_t node      = leader_compose_node;
+    bool     confirmed = node != LEADER_COMPOSE_DEAD_NODE && leader_compose_speculated == node;
+    if (!confirmed && leader_compose_speculated != LEADER_COMPOSE_DEAD_NODE) {
+        leader_compose_speculation_retract();
+    }
+    leader_compose_speculated = LEADER_COMPOSE_DEAD_NODE;
+
+    if (node == LEADER_COMPOSE_DEAD_NODE ||
+        pgm_read_word(&leader_compose_trie[node].action) == LEADER_COMPOSE_NO_ACTION) {
+        return confirmed;
+    }
+    if (leader_compose_confidence[node] < LEADER_COMPOSE_SPECULATIVE_MAX) {
+        leader_compose_confidence[node]++;
+    }
+    leader_compose_confidence_decay(pgm_read_word(&leader_compose_trie[node].first_child),
+                                    pgm_read_byte(&leader_compose_trie[node].child_count), node);
+    // Nothing is speculated on the root, its children only compete with their own children
+    uint16_t prefix = leader_compose_prefix_node;
+    if (prefix != LEADER_COMPOSE_ROOT_NODE) {
+        leader_compose_confidence_decay(prefix, 1, node);
+        leader_compose_confidence_decay(pgm_read_word(&leader_compose_trie[prefix].first_child),
+                                        pgm_read_byte(&leader_compose_trie[prefix].child_count),
+                                        node);
+    }
+    return confirmed;
+}
+#endif
+
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+static leader_compose_rhythm_t *leader_compose_rhythm(uint32_t hash) {
+    return &leader_compose_adaptive.rhythm[hash & (LEADER_COMPOSE_ADAPTIVE_SLOTS - 1)];
+}
+
+static uint16_t leader_compose_isqrt(uint16_t value) {
+    uint16_t root = 0;
+    for (uint16_t bit = 1 << 14; bit; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+/**
+ * Folds the interval between the last key of the prefix `hash` and the key extending it into
+ * that prefix's exponential moving average and variance.
+ */
+static void leader_compose_adaptive_learn(uint32_t hash, uint16_t interval) {
+    leader_compose_rhythm_t *rhythm = leader_compose_rhythm(hash);
+    uint16_t                 tag    = hash >> 16;
+    if (interval > LEADER_TIMEOUT) {
+        interval = LEADER_TIMEOUT;
+    }
+
+    if (rhythm->tag != tag || rhythm->samples == 0) {
+        rhythm->tag      = tag;
+        rhythm->mean     = interval << LEADER_COMPOSE_ADAPTIVE_FRACTION;
+        rhythm->variance = 0;
+        rhythm->samples  = 0;
+    }
+
+    int32_t  delta    = ((int32_t)interval << LEADER_COMPOSE_ADAPTIVE_FRACTION) - rhythm->mean;
+    uint32_t delta_ms = (delta < 0 ? -delta : delta) >> LEADER_COMPOSE_ADAPTIVE_FRACTION;
+    uint32_t variance = rhythm->variance - (rhythm->variance >> LEADER_COMPOSE_ADAPTIVE_SHIFT) +
+                        ((delta_ms * delta_ms) >> LEADER_COMPOSE_ADAPTIVE_SHIFT);
+    rhythm->mean += delta / (1 << LEADER_COMPOSE_ADAPTIVE_SHIFT);
+    rhythm->variance = variance > UINT16_MAX ? UINT16_MAX : variance;
+    if (rhythm->samples < UINT8_MAX) {
+        rhythm->samples++;
+    }
+
+    // Four deviations above the mean keeps slow outliers of a well known prefix from misfiring
+    uint32_t timeout = (rhythm->mean >> LEADER_COMPOSE_ADAPTIVE_FRACTION) +
+                       4 * leader_compose_isqrt(rhythm->variance) + LEADER_COMPOSE_ADAPTIVE_MARGIN;
+    if (timeout < LEADER_COMPOSE_ADAPTIVE_MIN_TIMEOUT) {
+        timeout = LEADER_COMPOSE_ADAPTIVE_MIN_TIMEOUT;
+    }
+    rhythm->timeout = timeout < LEADER_TIMEOUT ? timeout : LEADER_TIMEOUT;
+
+#    ifdef LEADER_COMPOSE_ADAPTIVE_PERSIST
+    leader_compose_adaptive_updates++;
+#    endif
+}
+
+/**
+ * Called on every key press. A key extending the prefix the last sequence timed out on shows the
+ * timeout was too short for it, so its interval is learned like any other and the timeout grows
+ * back instead of missing every slower attempt.
+ */
+static void leader_compose_adaptive_late_key(uint8_t key) {
+    uint16_t node            = leader_compose_late_node;
+    leader_compose_late_node = LEADER_COMPOSE_DEAD_NODE;
+    if (leader_compose_trie_child(node, key) == LEADER_COMPOSE_DEAD_NODE) {
+        return;
+    }
+    uint16_t interval = timer_elapsed(leader_compose_time);
+    if (interval <= LEADER_TIMEOUT) {
+        leader_compose_adaptive_learn(leader_compose_late_hash, interval);
+    }
+}
+
+static uint16_t leader_compose_adaptive_timeout(uint32_t hash) {
+    leader_compose_rhythm_t *rhythm = leader_compose_rhythm(hash);
+    if (rhythm->tag != (uint16_t)(hash >> 16) ||
+        rhythm->samples < LEADER_COMPOSE_ADAPTIVE_MIN_SAMPLES) {
+        return LEADER_TIMEOUT;
+    }
+    return rhythm->timeout;
+}
+
+#    ifdef LEADER_COMPOSE_ADAPTIVE_PERSIST
+static void leader_compose_adaptive_load(void) {
+    if (leader_compose_adaptive_loaded) {
+        return;
+    }
+    leader_compose_adaptive_loaded = true;
+    eeconfig_read_user_datablock(&leader_compose_adaptive);
+    if (leader_compose_adaptive.magic != LEADER_COMPOSE_ADAPTIVE_MAGIC) {
+        memset(&leader_compose_adaptive, 0, sizeof(leader_compose_adaptive));
+        leader_compose_adaptive.magic = LEADER_COMPOSE_ADAPTIVE_MAGIC;
+    }
+}
+
+// The EEPROM is emulated in flash on most boards, so only write back every few updates
+static void leader_compose_adaptive_save(void) {
+    if (leader_compose_adaptive_updates < LEADER_COMPOSE_ADAPTIVE_SAVE_INTERVAL) {
+        return;
+    }
+    leader_compose_adaptive_updates = 0;
+    eeconfig_update_user_datablock(&leader_compose_adaptive);
+}
+#    endif
+#endif
 
 void leader_compose_start(void) {
     if (leading) {
         return;
     }
     leader_compose_start_user();
+#ifdef LEADER_COMPOSE_ADAPTIVE_PERSIST
+    leader_compose_adaptive_load();
+#endif
     leading                      = true;
     leader_compose_time          = timer_read();
     leader_compose_sequence_size = 0;
-    memset(leader_compose_sequence, 0, sizeof(leader_compose_sequence));
-}
-
-bool leader_compose_sequence_done(void) {
-    return leader_compose_sequence_active() &&
-           (leader_compose_sequence_timed_out() || leader_compose_final_sequences());
+    leader_compose_sequence      = 0;
+    leader_compose_hash          = LEADER_COMPOSE_HASH_SEED;
+    leader_compose_node          = LEADER_COMPOSE_ROOT_NODE;
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+    leader_compose_timeout = LEADER_TIMEOUT;
+#endif
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_prefix_node = LEADER_COMPOSE_ROOT_NODE;
+#endif
 }
 
 void leader_compose_end(void) {
-    leading = false;
-    if (leader_compose_sequence_timed_out()) {
-        leader_compose_on_timeout_sequences();
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+    if (leader_compose_sequence_size > 0 && leader_compose_sequence_timed_out() &&
+        !leader_compose_sequence_resolved()) {
+        leader_compose_late_node = leader_compose_node;
+        leader_compose_late_hash = leader_compose_hash;
+    }
+#endif
+    leading      = false;
+    bool has_run = false;
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    has_run = leader_compose_speculation_settle();
+    leader_compose_held_arm_pending();
+#endif
+    if (!has_run && !leader_compose_trie_run(leader_compose_node)) {
+        leader_compose_on_no_match_user();
     }
+#ifdef LEADER_COMPOSE_ADAPTIVE_PERSIST
+    leader_compose_adaptive_save();
+#endif
     leader_compose_end_user();
 }
 
 void leader_compose_task(void) {
-    if (leader_compose_sequence_done()) {
+    if (!leader_compose_sequence_active()) {
+        return;
+    }
+    if (leader_compose_sequence_resolved() || leader_compose_sequence_timed_out()) {
         leader_compose_end();
     }
 }
 
+bool leader_compose_sequence_resolved(void) {
+    if (leader_compose_node == LEADER_COMPOSE_DEAD_NODE) {
+        return true;
+    }
+    return leader_compose_node != LEADER_COMPOSE_ROOT_NODE &&
+           pgm_read_byte(&leader_compose_trie[leader_compose_node].child_count) == 0;
+}
+
 bool leader_compose_sequence_active(void) {
     return leading;
 }
 
 bool leader_compose_sequence_add(uint16_t keycode) {
-    if (leader_compose_sequence_size >= ARRAY_SIZE(leader_compose_sequence)) {
+    if (leader_compose_sequence_size >= LEADER_SEQUENCE_SIZE) {
         return false;
     }
 
@@ -81,49 +467,82 @@ bool leader_compose_sequence_add(uint16_t keycode) {
     }
 #endif
 
-    leader_compose_sequence[leader_compose_sequence_size] = keycode;
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+    uint32_t prefix_hash = leader_compose_hash;
+#endif
+    uint8_t key = leader_compose_compress_keycode(keycode);
+    leader_compose_sequence |= (leader_compose_packed_t)key << (8 * leader_compose_sequence_size);
+    leader_compose_hash = (leader_compose_hash ^ key) * LEADER_COMPOSE_HASH_PRIME;
     leader_compose_sequence_size++;
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_prefix_node = leader_compose_node;
+#endif
+    leader_compose_node = leader_compose_trie_child(leader_compose_node, key);
+
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+    // Only learn from keys that extend a real prefix, typos would skew the rhythm
+    if (leader_compose_sequence_size > 1 && leader_compose_node != LEADER_COMPOSE_DEAD_NODE) {
+        leader_compose_adaptive_learn(prefix_hash, timer_elapsed(leader_compose_time));
+    }
+    leader_compose_timeout = leader_compose_adaptive_timeout(leader_compose_hash);
+#endif
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_speculate();
+#endif
 
     return true;
 }
 
-bool leader_compose_sequence_timed_out(void) {
-#if defined(LEADER_NO_TIMEOUT)
-    return leader_compose_sequence_size > 0 && timer_elapsed(leader_compose_time) > LEADER_TIMEOUT;
-#else
-    return timer_elapsed(leader_compose_time) > LEADER_TIMEOUT;
-#endif
+uint8_t leader_compose_compress_keycode(uint16_t keycode) {
+    return LEADER_COMPOSE_KEY(keycode);
 }
 
-void leader_compose_reset_timer(void) {
-    leader_compose_time = timer_read();
+static uint16_t leader_compose_tap_keycode(uint16_t keycode) {
+#ifndef LEADER_KEY_STRICT_KEY_PROCESSING
+    if (IS_QK_MOD_TAP(keycode)) {
+        return QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+    } else if (IS_QK_LAYER_TAP(keycode)) {
+        return QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
+    }
+#endif
+    return keycode;
 }
 
-bool leader_compose_sequence_is(uint16_t kc1, uint16_t kc2, uint16_t kc3, uint16_t kc4,
-                                uint16_t kc5, uint16_t sequence[5]) {
-    return sequence[0] == kc1 && sequence[1] == kc2 && sequence[2] == kc3 && sequence[3] == kc4 &&
-           sequence[4] == kc5;
+uint8_t leader_compose_record_key(uint16_t keycode, keyrecord_t *record) {
+#ifdef LEADER_COMPOSE_MATCH_POSITION
+    return LEADER_COMPOSE_KEYPOS(record->event.key.row, record->event.key.col);
+#else
+    return leader_compose_compress_keycode(leader_compose_tap_keycode(keycode));
+#endif
 }
 
-bool leader_compose_sequence_one_key(uint16_t kc) {
-    return leader_compose_sequence_is(kc, 0, 0, 0, 0, leader_compose_sequence);
+leader_compose_packed_t leader_compose_sequence_packed(void) {
+    return leader_compose_sequence;
 }
 
-bool leader_compose_sequence_two_keys(uint16_t kc1, uint16_t kc2) {
-    return leader_compose_sequence_is(kc1, kc2, 0, 0, 0, leader_compose_sequence);
+uint32_t leader_compose_sequence_hash(void) {
+    return leader_compose_hash;
 }
 
-bool leader_compose_sequence_three_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3) {
-    return leader_compose_sequence_is(kc1, kc2, kc3, 0, 0, leader_compose_sequence);
+bool leader_compose_sequence_timed_out(void) {
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+    uint16_t timeout = leader_compose_timeout;
+#else
+    uint16_t timeout = LEADER_TIMEOUT;
+#endif
+#if defined(LEADER_NO_TIMEOUT)
+    return leader_compose_sequence_size > 0 && timer_elapsed(leader_compose_time) > timeout;
+#else
+    return timer_elapsed(leader_compose_time) > timeout;
+#endif
 }
 
-bool leader_compose_sequence_four_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3, uint16_t kc4) {
-    return leader_compose_sequence_is(kc1, kc2, kc3, kc4, 0, leader_compose_sequence);
+void leader_compose_reset_timer(void) {
+    leader_compose_time = timer_read();
 }
 
-bool leader_compose_sequence_five_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3, uint16_t kc4,
-                                       uint16_t kc5) {
-    return leader_compose_sequence_is(kc1, kc2, kc3, kc4, kc5, leader_compose_sequence);
+bool leader_compose_sequence_is(leader_compose_packed_t sequence) {
+    return leader_compose_sequence == sequence;
 }
 
 bool process_leader_compose(uint16_t keycode, keyrecord_t *record) {
@@ -131,6 +550,11 @@ bool process_leader_compose(uint16_t keycode, keyrecord_t *record) {
             keycode, record->event.key.col, record->event.key.row, record->event.pressed,
             record->event.time, record->tap.interrupted, record->tap.count);
     if (record->event.pressed) {
+#ifdef LEADER_COMPOSE_ADAPTIVE_TIMEOUT
+        if (!leader_compose_sequence_active()) {
+            leader_compose_adaptive_late_key(leader_compose_record_key(keycode, record));
+        }
+#endif
         if (keycode == QK_LEAD) {
             leader_compose_down = true;
             leader_compose_start();
@@ -143,15 +567,7 @@ bool process_leader_compose(uint16_t keycode, keyrecord_t *record) {
         }
 #endif
         if (leader_compose_sequence_active() && !leader_compose_sequence_timed_out()) {
-#ifndef LEADER_KEY_STRICT_KEY_PROCESSING
-            if (IS_QK_MOD_TAP(keycode)) {
-                keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
-            } else if (IS_QK_LAYER_TAP(keycode)) {
-                keycode = QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
-            }
-#endif
-
-            if (!leader_compose_sequence_add(keycode)) {
+            if (!leader_compose_sequence_add(leader_compose_record_key(keycode, record))) {
                 leader_compose_end();
 
                 return true;
@@ -167,60 +583,107 @@ bool process_leader_compose(uint16_t keycode, keyrecord_t *record) {
         leader_compose_down = false;
 #ifdef LEADER_COMPOSE_CONTINUOUS_TRIGGER
     } else {
-        leader_compose_on_key_release(keycode);
+        leader_compose_on_key_release(keycode, record);
 #endif
     }
 
     return true;
 }
 
-int leader_compose_match_held_sequence(uint16_t key0, uint16_t key1, uint16_t key2, uint16_t key3,
-                                       uint16_t key4) {
-    if (leader_compose_sequence_held[0] == KC_NO) {
+static bool leader_compose_held_release_key_is_set(uint8_t key) {
+    return leader_compose_held_release_keys[key / 32] & (1UL << (key % 32));
+}
+
+static void leader_compose_held_release_key_update(uint8_t key, bool set) {
+    if (set) {
+        leader_compose_held_release_keys[key / 32] |= 1UL << (key % 32);
+    } else {
+        leader_compose_held_release_keys[key / 32] &= ~(1UL << (key % 32));
+    }
+}
+
+static uint8_t leader_compose_packed_last_key(leader_compose_packed_t sequence) {
+    uint8_t key = 0;
+    for (; sequence; sequence >>= 8) {
+        key = sequence;
+    }
+    return key;
+}
+
+// Slots whose key releases them
+static uint8_t leader_compose_held_live(void) {
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    return leader_compose_held_used & ~leader_compose_held_pending;
+#else
+    return leader_compose_held_used;
+#endif
+}
+
+/**
+ * Slots a lookup sees. A key release only sees the slots it releases, while retracting only the
+ * slots of the speculated action are seen, so neither mixes up a pending slot with an older slot
+ * holding the same sequence.
+ */
+static uint8_t leader_compose_held_lookup(void) {
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    if (leader_compose_retracting) {
+        return leader_compose_held_pending;
+    } else if (leader_compose_releasing) {
+        return leader_compose_held_live();
+    }
+#endif
+    return leader_compose_held_used;
+}
+
+int leader_compose_match_held_sequence(leader_compose_packed_t sequence) {
+    uint8_t key   = leader_compose_packed_last_key(sequence);
+    uint8_t slots = leader_compose_held_lookup();
+    if (slots == leader_compose_held_live() && !leader_compose_held_release_key_is_set(key)) {
         return -1;
     }
-    for (int i = 0; i < 2; i++) {
-        dprintf("\nINDEX %d: Seq 0x%04X 0x%04X 0x%04X 0x%04X 0x%04X", i, key0, key1, key2, key3,
-                key4);
-        dprintf("\nSTORED INDEX %d: Seq 0x%04X 0x%04X 0x%04X 0x%04X 0x%04X\n", i,
-                leader_compose_sequence_held[i][0], leader_compose_sequence_held[i][1],
-                leader_compose_sequence_held[i][2], leader_compose_sequence_held[i][3],
-                leader_compose_sequence_held[i][4]);
-        if (leader_compose_sequence_is(key0, key1, key2, key3, key4,
-                                       leader_compose_sequence_held[i])) {
+    for (uint8_t i = 0; i < LEADER_COMPOSE_HELD_SLOTS; i++) {
+        if ((slots & (1 << i)) && leader_compose_held_release_key[i] == key &&
+            leader_compose_sequence_held[i] == sequence) {
             return i;
         }
     }
     return -1;
 }
 
-void release_held_sequence(int index) {
-    if (index == 0 && leader_compose_sequence_held[1][0] != KC_NO) {
-        memcpy(&leader_compose_sequence_held[0], &leader_compose_sequence_held[1],
-               sizeof(leader_compose_sequence_held[0]));
-        memset(&leader_compose_sequence_held[1], 0, sizeof(leader_compose_sequence_held[1]));
-        return;
+static void release_held_sequence(uint8_t index) {
+    uint8_t key = leader_compose_held_release_key[index];
+    leader_compose_held_used &= ~(1 << index);
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_held_pending &= ~(1 << index);
+#endif
+
+    bool    still_held = false;
+    uint8_t live       = leader_compose_held_live();
+    for (uint8_t i = 0; i < LEADER_COMPOSE_HELD_SLOTS; i++) {
+        if ((live & (1 << i)) && leader_compose_held_release_key[i] == key) {
+            still_held = true;
+        }
     }
-    memset(&leader_compose_sequence_held[index], 0, sizeof(leader_compose_sequence_held[index]));
+    leader_compose_held_release_key_update(key, still_held);
 }
 
-void leader_compose_on_key_release(uint16_t keycode) {
+void leader_compose_on_key_release(uint16_t keycode, keyrecord_t *record) {
+    if (!leader_compose_held_release_key_is_set(leader_compose_record_key(keycode, record))) {
+        return;
+    }
+    keycode = leader_compose_tap_keycode(keycode);
     dprintf("Keycode 0x%04X was released, calling compose end\n", keycode);
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_releasing = true;
+#endif
     leader_compose_on_key_release_user(keycode);
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    leader_compose_releasing = false;
+#endif
 }
 
-bool leader_compose_release_sequence_one_key(uint16_t key0) {
-    int held_index = leader_compose_match_held_sequence(key0, 0, 0, 0, 0);
-    if (held_index == -1) {
-        return false;
-    }
-
-    release_held_sequence(held_index);
-    return true;
-}
-
-bool leader_compose_release_sequence_two_keys(uint16_t key0, uint16_t key1) {
-    int held_index = leader_compose_match_held_sequence(key0, key1, 0, 0, 0);
+bool leader_compose_release_held_sequence(leader_compose_packed_t sequence) {
+    int held_index = leader_compose_match_held_sequence(sequence);
     if (held_index == -1) {
         return false;
     }
@@ -229,51 +692,43 @@ bool leader_compose_release_sequence_two_keys(uint16_t key0, uint16_t key1) {
     return true;
 }
 
-bool leader_compose_release_sequence_three_keys(uint16_t key0, uint16_t key1, uint16_t key2) {
-    int held_index = leader_compose_match_held_sequence(key0, key1, key2, 0, 0);
-    if (held_index == -1) {
-        return false;
+bool leader_compose_hold_sequence(leader_compose_packed_t sequence) {
+    uint8_t free_slots = ~leader_compose_held_used;
+    if (LEADER_COMPOSE_HELD_SLOTS < 8) {
+        free_slots &= (1 << LEADER_COMPOSE_HELD_SLOTS) - 1;
     }
-
-    release_held_sequence(held_index);
-    return true;
-}
-bool leader_compose_release_sequence_four_keys(uint16_t key0, uint16_t key1, uint16_t key2,
-                                               uint16_t key3) {
-    int held_index = leader_compose_match_held_sequence(key0, key1, key2, key3, 0);
-    if (held_index == -1) {
+    if (free_slots == 0) {
+        dprintln("No free slot to hold the sequence");
         return false;
     }
 
-    release_held_sequence(held_index);
-    return true;
-}
-bool leader_compose_release_sequence_five_keys(uint16_t key0, uint16_t key1, uint16_t key2,
-                                               uint16_t key3, uint16_t key4) {
-    int held_index = leader_compose_match_held_sequence(key0, key1, key2, key3, key4);
-    if (held_index == -1) {
-        return false;
+    uint8_t id                          = __builtin_ctz(free_slots);
+    leader_compose_sequence_held[id]    = sequence;
+    leader_compose_held_release_key[id] = leader_compose_packed_last_key(sequence);
+    leader_compose_held_used |= 1 << id;
+#ifdef LEADER_COMPOSE_SPECULATIVE
+    if (leader_compose_speculating) {
+        // Fired on the press of a key the sequence may still be typed with, its release must not
+        // undo the action before the sequence is even complete
+        leader_compose_held_pending |= 1 << id;
+    } else
+#endif
+    {
+        leader_compose_held_release_key_update(leader_compose_held_release_key[id], true);
     }
-
-    release_held_sequence(held_index);
+    dprintf("\nREGISTERING INDEX %d: Seq 0x%08lX%08lX\n", id,
+            (uint32_t)(leader_compose_sequence_held[id] >> 32),
+            (uint32_t)leader_compose_sequence_held[id]);
     return true;
 }
 
-void leader_compose_register_sequence_held(uint16_t key0, uint16_t key1, uint16_t key2,
-                                           uint16_t key3, uint16_t key4) {
-    size_t id;
-    if (leader_compose_sequence_held[0][0] == KC_NO) {
-        id = 0;
-    } else {
-        id = 1;
-    }
-    memcpy(&leader_compose_sequence_held[id][0], &key0, sizeof(leader_compose_sequence_held[0][0]));
-    memcpy(&leader_compose_sequence_held[id][1], &key1, sizeof(leader_compose_sequence_held[0][1]));
-    memcpy(&leader_compose_sequence_held[id][2], &key2, sizeof(leader_compose_sequence_held[0][2]));
-    memcpy(&leader_compose_sequence_held[id][3], &key3, sizeof(leader_compose_sequence_held[0][3]));
-    memcpy(&leader_compose_sequence_held[id][4], &key4, sizeof(leader_compose_sequence_held[0][4]));
-    dprintf("\nREGISTERING INDEX %d: Seq 0x%04X 0x%04X 0x%04X 0x%04X 0x%04X\n", id,
-            leader_compose_sequence_held[id][0], leader_compose_sequence_held[id][1],
-            leader_compose_sequence_held[id][2], leader_compose_sequence_held[id][3],
-            leader_compose_sequence_held[id][4]);
+#ifdef LEADER_COMPOSE_SPECULATIVE
+static void leader_compose_held_arm_pending(void) {
+    for (uint8_t i = 0; i < LEADER_COMPOSE_HELD_SLOTS; i++) {
+        if (leader_compose_held_pending & (1 << i)) {
+            leader_compose_held_release_key_update(leader_compose_held_release_key[i], true);
+        }
+    }
+    leader_compose_held_pending = 0;
 }
+#endif
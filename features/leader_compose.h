@@ -1,9 +1,21 @@
 // Copyright 2023 QMK
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#pragma once
+
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "action.h"
+#include "progmem.h"
+
+#ifndef LEADER_SEQUENCE_SIZE
+#    define LEADER_SEQUENCE_SIZE 5
+#endif
+
+#if LEADER_SEQUENCE_SIZE > 8
+#    error "LEADER_SEQUENCE_SIZE must be at most 8, sequences are packed into a uint64_t"
+#endif
 
 /**
  * \file
@@ -13,6 +25,54 @@
  * \{
  */
 
+/**
+ * Index of the root node in `leader_compose_trie`.
+ */
+#define LEADER_COMPOSE_ROOT_NODE 0
+/**
+ * Matcher state once the buffer no longer matches any prefix in the trie.
+ */
+#define LEADER_COMPOSE_DEAD_NODE UINT16_MAX
+/**
+ * Action index of trie nodes that only exist as a prefix.
+ */
+#define LEADER_COMPOSE_NO_ACTION UINT16_MAX
+
+/**
+ * Compressed key stored for keycodes outside of the basic range, it never matches a sequence.
+ */
+#define LEADER_COMPOSE_KEY_OTHER 0xFF
+
+/**
+ * \brief A whole sequence packed into one word.
+ *
+ * Each key is compressed to 8 bits, the first key sits in the lowest byte and unused keys are
+ * zero, so comparing two sequences is a single integer compare.
+ */
+typedef uint64_t leader_compose_packed_t;
+
+typedef void (*leader_compose_action_t)(void);
+
+/**
+ * \brief A node of the flash-resident sequence trie.
+ *
+ * Generated by `features/leader_compose_trie.py` from a keymap's `leader_sequences.def`. Children
+ * of a node are contiguous, so a node only stores the index of its first child and their count.
+ * A node without children resolves as soon as it is reached, a node with children waits for the
+ * timeout in case the sequence is extended.
+ */
+typedef struct {
+    uint16_t first_child;
+    uint16_t action;
+    uint8_t  key;
+    uint8_t  child_count;
+} leader_compose_node_t;
+
+/**
+ * \brief User callback, invoked when the leader_compose sequence ends without matching.
+ */
+void leader_compose_on_no_match_user(void);
+
 /**
  * \brief User callback, invoked when the leader_compose sequence begins.
  */
@@ -29,12 +89,27 @@ void leader_compose_end_user(void);
 void leader_compose_start(void);
 
 /**
- * End the leader_compose sequence.
+ * End the leader_compose sequence, running the action of the matched sequence if there is one.
+ *
+ * If `LEADER_COMPOSE_SPECULATIVE` is defined, sequences declared with
+ * `LEADER_SPECULATIVE_SEQUENCE` fire as soon as their prefix is typed once they became the usual
+ * completion of it. A wrong guess is retracted with the sequence's undo function as soon as the
+ * next key or the timeout disproves it, and an action that already ran is not run again here.
  */
 void leader_compose_end(void);
 
+/**
+ * Ends the sequence once it is resolved: the buffer is dead, it is a complete match that no other
+ * sequence extends, or it timed out.
+ */
 void leader_compose_task(void);
 
+/**
+ * Whether the sequence buffer can no longer change the outcome, either because no sequence starts
+ * with it or because it is a complete match that no sequence extends.
+ */
+bool leader_compose_sequence_resolved(void);
+
 /**
  * Whether the leader_compose sequence is active.
  */
@@ -43,18 +118,51 @@ bool leader_compose_sequence_active(void);
 /**
  * Add the given keycode to the sequence buffer.
  *
- * If `LEADER_NO_TIMEOUT` is defined, the timer is reset if the buffer is empty.
+ * If `LEADER_NO_TIMEOUT` is defined, the timer is reset if the buffer is empty. The trie matcher
+ * advances by one node, so the cost does not depend on how many sequences are defined.
  *
- * \param keycode The keycode to add.
+ * \param keycode The keycode to add, or a `LEADER_COMPOSE_KEYPOS()` if
+ *                `LEADER_COMPOSE_MATCH_POSITION` is defined.
  *
  * \return `true` if the keycode was added, `false` if the buffer is full.
  */
 bool leader_compose_sequence_add(uint16_t keycode);
 
+/**
+ * Compress a keycode to the 8-bit key stored in packed sequences.
+ *
+ * \return The basic keycode, or `LEADER_COMPOSE_KEY_OTHER` if it does not fit.
+ */
+uint8_t leader_compose_compress_keycode(uint16_t keycode);
+
+/**
+ * The key a record adds to the sequence buffer: its `LEADER_COMPOSE_KEYPOS()` if
+ * `LEADER_COMPOSE_MATCH_POSITION` is defined, otherwise its compressed tap keycode.
+ */
+uint8_t leader_compose_record_key(uint16_t keycode, keyrecord_t *record);
+
+/**
+ * The sequence buffer packed into a single word.
+ */
+leader_compose_packed_t leader_compose_sequence_packed(void);
+
+/**
+ * Rolling FNV-1a hash of the sequence buffer, updated as keys are added.
+ *
+ * The hash of a sequence only depends on its keys, so it can key per-prefix tables without walking
+ * the buffer. Each key added changes it, every prefix has its own hash.
+ */
+uint32_t leader_compose_sequence_hash(void);
+
 /**
  * Whether the leader_compose sequence has reached the timeout.
  *
  * If `LEADER_NO_TIMEOUT` is defined, the buffer must also contain at least one key.
+ *
+ * If `LEADER_COMPOSE_ADAPTIVE_TIMEOUT` is defined, the timeout of each prefix is learned from how
+ * fast it is usually extended and never exceeds `LEADER_TIMEOUT`. A key extending a prefix right
+ * after it timed out is learned too, so the timeout grows back when typing slows down. Define
+ * `LEADER_COMPOSE_ADAPTIVE_PERSIST` and `EECONFIG_USER_DATA_SIZE` to keep it in EEPROM.
  */
 bool leader_compose_sequence_timed_out(void);
 
@@ -64,74 +172,116 @@ bool leader_compose_sequence_timed_out(void);
 void leader_compose_reset_timer(void);
 
 /**
- * Check the sequence buffer for the given keycode.
- *
- * \param kc The keycode to check.
+ * Key of the physical position `row`, `col`, packed into a nibble each and offset by one, so no
+ * position is 0, the key of unused entries of a packed sequence.
  *
- * \return `true` if the sequence buffer matches.
+ * If `LEADER_COMPOSE_MATCH_POSITION` is defined, the sequence buffer records where keys are instead
+ * of what they send, so sequences are written with these, e.g.
+ * `leader_compose_sequence(LEADER_COMPOSE_KEYPOS(3, 2))`, and match on every layer.
+ */
+#define LEADER_COMPOSE_KEYPOS(row, col) ((((row) << 4) | (col)) + 1)
+
+/**
+ * Compress a keycode at compile time, see `leader_compose_compress_keycode()`.
  */
-bool leader_compose_sequence_one_key(uint16_t kc);
+#define LEADER_COMPOSE_KEY(kc) \
+    ((leader_compose_packed_t)((kc) < LEADER_COMPOSE_KEY_OTHER ? (kc) : LEADER_COMPOSE_KEY_OTHER))
+
+// Fails to compile when the key does not fit a packed sequence, like the trie generator checks
+#define LEADER_COMPOSE_ASSERT_KEY(kc)                                                    \
+    (0 * sizeof(struct {                                                                \
+         _Static_assert((kc) < LEADER_COMPOSE_KEY_OTHER, "leader sequence key does not " \
+                                                         "fit a leader_compose key");   \
+         char key;                                                                      \
+     }))
+
+#define LEADER_COMPOSE_PACK_KEY(kc) \
+    ((leader_compose_packed_t)LEADER_COMPOSE_ASSERT_KEY(kc) + LEADER_COMPOSE_KEY(kc))
+
+#define LEADER_COMPOSE_PACK_(k0, k1, k2, k3, k4, k5, k6, k7, ...)                             \
+    (LEADER_COMPOSE_PACK_KEY(k0) | LEADER_COMPOSE_PACK_KEY(k1) << 8 |                         \
+     LEADER_COMPOSE_PACK_KEY(k2) << 16 | LEADER_COMPOSE_PACK_KEY(k3) << 24 |                  \
+     LEADER_COMPOSE_PACK_KEY(k4) << 32 | LEADER_COMPOSE_PACK_KEY(k5) << 40 |                  \
+     LEADER_COMPOSE_PACK_KEY(k6) << 48 | LEADER_COMPOSE_PACK_KEY(k7) << 56)
+
+// Fails to compile when more than LEADER_SEQUENCE_SIZE keys are given, evaluates to 0
+#define LEADER_COMPOSE_ASSERT_LENGTH(...)                                        \
+    (0 * sizeof(struct {                                                        \
+         _Static_assert(sizeof((uint16_t[]){__VA_ARGS__}) <=                    \
+                            LEADER_SEQUENCE_SIZE * sizeof(uint16_t),            \
+                        "leader sequence is longer than LEADER_SEQUENCE_SIZE"); \
+         char length;                                                           \
+     }))
 
 /**
- * Check the sequence buffer for the given keycodes.
+ * Pack a sequence of up to `LEADER_SEQUENCE_SIZE` keycodes into a `leader_compose_packed_t`.
  *
- * \param kc1 The first keycode to check.
- * \param kc2 The second keycode to check.
+ * Any number of keys can be given, longer sequences fail a static assertion, and so do keycodes
+ * outside of the basic range, which would all pack to `LEADER_COMPOSE_KEY_OTHER`. Keycodes must be
+ * constants, the result is a compile time constant.
+ */
+#define LEADER_COMPOSE_PACK(...)               \
+    (LEADER_COMPOSE_ASSERT_LENGTH(__VA_ARGS__) + \
+     LEADER_COMPOSE_PACK_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0))
+
+/**
+ * Check the sequence buffer for the given keycodes, e.g. `leader_compose_sequence(KC_SPACE, KC_R)`.
  *
  * \return `true` if the sequence buffer matches.
  */
-bool leader_compose_sequence_two_keys(uint16_t kc1, uint16_t kc2);
+#define leader_compose_sequence(...) leader_compose_sequence_is(LEADER_COMPOSE_PACK(__VA_ARGS__))
 
 /**
- * Check the sequence buffer for the given keycodes.
+ * Release the held sequence made of the given keycodes.
  *
- * \param kc1 The first keycode to check.
- * \param kc2 The second keycode to check.
- * \param kc3 The third keycode to check.
+ * \return `true` if the sequence was held.
+ */
+#define leader_compose_release_sequence(...) \
+    leader_compose_release_held_sequence(LEADER_COMPOSE_PACK(__VA_ARGS__))
+
+/**
+ * Hold the sequence made of the given keycodes until its last key is released.
  *
- * \return `true` if the sequence buffer matches.
+ * \return `false` if every slot is in use.
+ */
+#define leader_compose_register_sequence_held(...) \
+    leader_compose_hold_sequence(LEADER_COMPOSE_PACK(__VA_ARGS__))
+
+/**
+ * Check the sequence buffer against a packed sequence.
  */
-bool leader_compose_sequence_three_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3);
+bool leader_compose_sequence_is(leader_compose_packed_t sequence);
+
+bool process_leader_compose(uint16_t keycode, keyrecord_t *record);
 
 /**
- * Check the sequence buffer for the given keycodes.
+ * Called on every key release, only forwards to `leader_compose_on_key_release_user()` when the
+ * key is the last key of a held sequence, which is a single bit test.
+ */
+void leader_compose_on_key_release(uint16_t keycode, keyrecord_t *record);
+
+/**
+ * Find the slot holding the given packed sequence.
  *
- * \param kc1 The first keycode to check.
- * \param kc2 The second keycode to check.
- * \param kc3 The third keycode to check.
- * \param kc4 The fourth keycode to check.
+ * \return The slot index, or `-1` if the sequence is not held.
+ */
+int leader_compose_match_held_sequence(leader_compose_packed_t sequence);
+
+/**
+ * Release the held packed sequence.
  *
- * \return `true` if the sequence buffer matches.
+ * \return `true` if the sequence was held.
  */
-bool leader_compose_sequence_four_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3, uint16_t kc4);
+bool leader_compose_release_held_sequence(leader_compose_packed_t sequence);
 
 /**
- * Check the sequence buffer for the given keycodes.
+ * Hold the packed sequence until its last key is released.
  *
- * \param kc1 The first keycode to check.
- * \param kc2 The second keycode to check.
- * \param kc3 The third keycode to check.
- * \param kc4 The fourth keycode to check.
- * \param kc5 The fifth keycode to check.
+ * Up to `LEADER_COMPOSE_HELD_SLOTS` (default 4) sequences can be held at once. A sequence held
+ * by a speculated action is only released by its key once the leader sequence ended, as the action
+ * would only have run then, so releasing the key that triggered the speculation keeps it held.
  *
- * \return `true` if the sequence buffer matches.
+ * \return `false` if every slot is in use.
  */
-bool leader_compose_sequence_five_keys(uint16_t kc1, uint16_t kc2, uint16_t kc3, uint16_t kc4,
-                                       uint16_t kc5);
-
-bool process_leader_compose(uint16_t keycode, keyrecord_t *record);
-
-void leader_compose_on_key_release(uint16_t keycode);
-int  leader_compose_match_held_sequence(uint16_t key0, uint16_t key1, uint16_t key2, uint16_t key3,
-                                        uint16_t key4);
-bool leader_compose_release_sequence_one_key(uint16_t key0);
-bool leader_compose_release_sequence_two_keys(uint16_t key0, uint16_t key1);
-bool leader_compose_release_sequence_three_keys(uint16_t key0, uint16_t key1, uint16_t key2);
-bool leader_compose_release_sequence_four_keys(uint16_t key0, uint16_t key1, uint16_t key2,
-                                               uint16_t key3);
-bool leader_compose_release_sequence_five_keys(uint16_t key0, uint16_t key1, uint16_t key2,
-                                               uint16_t key3, uint16_t key4);
-
-void leader_compose_register_sequence_held(uint16_t key0, uint16_t key1, uint16_t key2,
-                                           uint16_t key3, uint16_t key4);
+bool leader_compose_hold_sequence(leader_compose_packed_t sequence);
 /** \} */
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+# Copyright 2023 QMK
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Compile a leader_compose sequence list into a PROGMEM prefix trie.
+
+The input is an X-macro style list, one sequence per line:
+
+    LEADER_SEQUENCE(action, KC_A, KC_B)
+    LEADER_SPECULATIVE_SEQUENCE(action, undo, KC_SPACE, KC_R)
+
+`action` and `undo` are `void (void)` functions defined by the keymap. A
+sequence that is not the prefix of another fires as soon as it is typed,
+otherwise it fires when the leader times out. Speculative sequences may fire
+early when they are the usual completion of the buffer, `undo` retracts them
+if the guess was wrong.
+
+Keys are keycodes, or `LEADER_COMPOSE_KEYPOS(row, col)` when the keymap
+defines `LEADER_COMPOSE_MATCH_POSITION`.
+
+The trie is emitted breadth first, so the children of every node are stored
+contiguously and a node only needs the index of its first child and a count.
+Keys are stored compressed to 8 bits, so only basic keycodes can be used.
+
+leader_compose_trie.h declares the action lists and the tables, and
+leader_compose_trie.c defines them and is compiled with the keymap. The undo
+and confidence tables only exist with LEADER_COMPOSE_SPECULATIVE.
+
+Usage:
+    python3 features/leader_compose_trie.py path/to/leader_sequences.def [-d directory]
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+SEQUENCE_RE = re.compile(r'^\s*LEADER_(SPECULATIVE_)?SEQUENCE\s*\((.*)\)\s*$')
+COMMENT_RE = re.compile(r'//.*$')
+# Commas that are not nested in parentheses, so LEADER_COMPOSE_KEYPOS(row, col) stays one key
+ARGUMENT_RE = re.compile(r'(?:[^,()]|\([^()]*\))+')
+
+
+class Node:
+    def __init__(self, key, depth):
+        self.key = key
+        self.depth = depth
+        self.children = []
+        self.action = None
+        self.index = 0
+
+    def child(self, key):
+        for node in self.children:
+            if node.key == key:
+                return node
+        node = Node(key, self.depth + 1)
+        self.children.append(node)
+        return node
+
+
+def parse(path):
+    sequences = []
+    for lineno, line in enumerate(path.read_text().splitlines(), 1):
+        line = COMMENT_RE.sub('', line).strip()
+        if not line:
+            continue
+        match = SEQUENCE_RE.match(line)
+        if not match:
+            sys.exit(f'{path}:{lineno}: expected LEADER_SEQUENCE(action, keys...) or '
+                     'LEADER_SPECULATIVE_SEQUENCE(action, undo, keys...)')
+        args = [arg.strip() for arg in ARGUMENT_RE.findall(match.group(2))]
+        undo = args.pop(1) if match.group(1) and len(args) > 1 else None
+        if len(args) < 2 or not all(args):
+            sys.exit(f'{path}:{lineno}: a sequence needs an action and at least one key')
+        sequences.append((lineno, args[0], undo, args[1:]))
+    return sequences
+
+
+def build(path, sequences):
+    root = Node('KC_NO', 0)
+    actions = {}
+    for lineno, action, undo, keys in sequences:
+        node = root
+        for key in keys:
+            node = node.child(key)
+        if node.action is not None:
+            sys.exit(f'{path}:{lineno}: sequence {", ".join(keys)} is already bound to {node.action}')
+        if actions.setdefault(action, undo) != undo:
+            sys.exit(f'{path}:{lineno}: {action} is already undone by {actions[action]}')
+        node.action = action
+    return root, actions
+
+
+def flatten(root):
+    nodes = [root]
+    for node in nodes:
+        nodes.extend(node.children)
+    for index, node in enumerate(nodes):
+        node.index = index
+    return nodes
+
+
+def render_header(path, nodes, actions):
+    undos = [undo for undo in actions.values() if undo]
+    lines = [
+        f'// Generated by features/leader_compose_trie.py from {path.name}, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '#include "features/leader_compose.h"',
+        '',
+        f'#define LEADER_COMPOSE_ACTION_COUNT {len(actions)}',
+        f'#define LEADER_COMPOSE_NODE_COUNT   {len(nodes)}',
+        '',
+        '// clang-format off',
+        '#define LEADER_COMPOSE_ACTIONS(X) \\',
+    ]
+    lines += [f'    X({action}) \\' for action in actions]
+    lines += [
+        '',
+        '#define LEADER_COMPOSE_UNDOS(X) \\',
+    ]
+    lines += [f'    X({undo}) \\' for undo in undos]
+    lines += [
+        '',
+        '// clang-format on',
+        '',
+        '#define LEADER_COMPOSE_DECLARE_ACTION(action) void action(void);',
+        'LEADER_COMPOSE_ACTIONS(LEADER_COMPOSE_DECLARE_ACTION)',
+        'LEADER_COMPOSE_UNDOS(LEADER_COMPOSE_DECLARE_ACTION)',
+        '#undef LEADER_COMPOSE_DECLARE_ACTION',
+        '',
+        'extern const leader_compose_node_t   leader_compose_trie[LEADER_COMPOSE_NODE_COUNT];',
+        'extern const leader_compose_action_t leader_compose_actions[LEADER_COMPOSE_ACTION_COUNT];',
+        '#ifdef LEADER_COMPOSE_SPECULATIVE',
+        'extern const leader_compose_action_t leader_compose_undos[LEADER_COMPOSE_ACTION_COUNT];',
+        'extern uint8_t                       leader_compose_confidence[LEADER_COMPOSE_NODE_COUNT];',
+        '#endif',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def render_source(path, nodes, actions):
+    depth = max(node.depth for node in nodes)
+    lines = [
+        f'// Generated by features/leader_compose_trie.py from {path.name}, do not edit.',
+        '',
+        '#include "leader_compose_trie.h"',
+        '',
+        f'_Static_assert({depth} <= LEADER_SEQUENCE_SIZE, "{path.name} has sequences longer than LEADER_SEQUENCE_SIZE");',
+    ]
+    keys = sorted({node.key for node in nodes[1:]})
+    lines += [f'_Static_assert({key} < LEADER_COMPOSE_KEY_OTHER, "{key} does not fit a leader_compose key");' for key in keys]
+    lines += [
+        '',
+        '// clang-format off',
+        'const leader_compose_action_t PROGMEM leader_compose_actions[LEADER_COMPOSE_ACTION_COUNT] = {',
+    ]
+    lines += [f'    {action},' for action in actions]
+    lines += [
+        '};',
+        '',
+        '#ifdef LEADER_COMPOSE_SPECULATIVE',
+        '// Retracts a speculatively fired action, NULL when the action cannot be speculated',
+        'const leader_compose_action_t PROGMEM leader_compose_undos[LEADER_COMPOSE_ACTION_COUNT] = {',
+    ]
+    lines += [f'    {undo or "NULL"},' for undo in actions.values()]
+    lines += [
+        '};',
+        '',
+        '// Speculation confidence of every node',
+        'uint8_t leader_compose_confidence[LEADER_COMPOSE_NODE_COUNT];',
+        '#endif',
+        '',
+        'const leader_compose_node_t PROGMEM leader_compose_trie[LEADER_COMPOSE_NODE_COUNT] = {',
+    ]
+    action_ids = list(actions)
+    for node in nodes:
+        first_child = node.children[0].index if node.children else 0
+        action = 'LEADER_COMPOSE_NO_ACTION' if node.action is None else action_ids.index(node.action)
+        comment = f' // {node.action}' if node.action else ''
+        lines.append(f'    /* {node.index:3} */ {{{first_child}, {action}, {node.key}, {len(node.children)}}},{comment}')
+    lines += [
+        '};',
+        '// clang-format on',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def write_if_changed(path, text):
+    # The keymap build runs the generator every time, an untouched file is not rebuilt
+    if not path.exists() or path.read_text() != text:
+        path.write_text(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('sequences', type=Path, help='leader_sequences.def to compile')
+    parser.add_argument('-d', '--directory', type=Path,
+                        help='where to write leader_compose_trie.{c,h}, defaults to the directory of the input')
+    args = parser.parse_args()
+
+    root, actions = build(args.sequences, parse(args.sequences))
+    nodes = flatten(root)
+    directory = args.directory or args.sequences.parent
+    directory.mkdir(parents=True, exist_ok=True)
+    write_if_changed(directory / 'leader_compose_trie.h', render_header(args.sequences, nodes, actions))
+    write_if_changed(directory / 'leader_compose_trie.c', render_source(args.sequences, nodes, actions))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+# Copyright 2023 QMK
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Compile per-layer HSV LED colors into palette-indexed RGB frames for the firmware.
+
+The input is an X-macro style list, one layer per line, with the HSV triple
+of every LED in LED index order, like the `ledmap` table Oryx exports:
+
+    LEDMAP_LAYER(0, {0, 0, 0}, {119, 240, 192}, ...)
+
+Colors are converted with the integer math of QMK's hsv_to_rgb() (without
+USE_CIE1931_CURVE), so the firmware only has to scale the frames by the
+brightness instead of converting every LED on every frame.
+
+Layers only use a handful of colors, so the RGB values go into a palette of
+up to 16 colors shared by every layer, black first, and each LED stores a
+4-bit palette index. Two LEDs share a byte, the even one in the low nibble.
+
+Usage:
+    python3 features/ledmap_frames.py path/to/ledmap.def [-o out.h]
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+LAYER_RE = re.compile(r'^\s*LEDMAP_LAYER\s*\(\s*(\d+)\s*,(.*)\)\s*$')
+HSV_RE = re.compile(r'\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)\s*\}')
+COMMENT_RE = re.compile(r'//.*$')
+
+
+def hsv_to_rgb(h, s, v):
+    """quantum/color.c hsv_to_rgb_impl() with its uint8_t truncations."""
+    if s == 0:
+        return v, v, v
+    region = h * 6 // 255
+    remainder = ((h * 2 - region * 85) * 3) & 0xFF
+    p = (v * (255 - s)) >> 8
+    q = (v * (255 - ((s * remainder) >> 8))) >> 8
+    t = (v * (255 - ((s * (255 - remainder)) >> 8))) >> 8
+    if region in (0, 6):
+        return v, t, p
+    if region == 1:
+        return q, v, p
+    if region == 2:
+        return p, v, t
+    if region == 3:
+        return p, q, v
+    if region == 4:
+        return t, p, v
+    return v, p, q
+
+
+PALETTE_SIZE = 16
+
+
+def parse(path):
+    layers = {}
+    for lineno, line in enumerate(path.read_text().splitlines(), 1):
+        line = COMMENT_RE.sub('', line).strip()
+        if not line:
+            continue
+        match = LAYER_RE.match(line)
+        if not match:
+            sys.exit(f'{path}:{lineno}: expected LEDMAP_LAYER(layer, {{h, s, v}}...)')
+        layer = int(match.group(1))
+        colors = [tuple(int(c) for c in hsv) for hsv in HSV_RE.findall(match.group(2))]
+        if any(c > 255 for hsv in colors for c in hsv):
+            sys.exit(f'{path}:{lineno}: HSV components go up to 255')
+        if layer in layers:
+            sys.exit(f'{path}:{lineno}: layer {layer} is already defined')
+        layers[layer] = colors
+
+    if not layers:
+        sys.exit(f'{path}: no layers')
+    if sorted(layers) != list(range(len(layers))):
+        sys.exit(f'{path}: layers must be numbered from 0 without gaps')
+    led_count = len(layers[0])
+    for layer, colors in layers.items():
+        if len(colors) != led_count:
+            sys.exit(f'{path}: layer {layer} has {len(colors)} LEDs, layer 0 has {led_count}')
+    return [layers[layer] for layer in range(len(layers))]
+
+
+def build_palette(path, layers):
+    palette = [(0, 0, 0)]
+    frames = []
+    for colors in layers:
+        frame = []
+        for rgb in (hsv_to_rgb(*hsv) for hsv in colors):
+            if rgb not in palette:
+                palette.append(rgb)
+            frame.append(palette.index(rgb))
+        frames.append(frame)
+    if len(palette) > PALETTE_SIZE:
+        sys.exit(f'{path}: {len(palette)} colors, 4-bit indices fit {PALETTE_SIZE}')
+    return palette, frames
+
+
+def pack(frame):
+    if len(frame) % 2:
+        frame = frame + [0]
+    return [frame[i] | frame[i + 1] << 4 for i in range(0, len(frame), 2)]
+
+
+def render(path, layers):
+    led_count = len(layers[0])
+    palette, frames = build_palette(path, layers)
+    lines = [
+        f'// Generated by features/ledmap_frames.py from {path.name}, do not edit.',
+        '',
+        '#pragma once',
+        '',
+        '#include <stdint.h>',
+        '#include "progmem.h"',
+        '',
+        f'#define LEDMAP_LAYER_COUNT   {len(layers)}',
+        f'#define LEDMAP_LED_COUNT     {led_count}',
+        f'#define LEDMAP_PALETTE_COUNT {len(palette)}',
+        '',
+        f'_Static_assert(LEDMAP_LED_COUNT == RGB_MATRIX_LED_COUNT, "{path.name} does not have a color for every LED");',
+        '',
+        '// clang-format off',
+        'const uint8_t PROGMEM ledmap_palette[LEDMAP_PALETTE_COUNT][3] = {',
+    ]
+    lines += ['    {%d, %d, %d},' % rgb for rgb in palette]
+    lines += [
+        '};',
+        '',
+        '// Palette index of every LED, the even LED of each pair in the low nibble',
+        'const uint8_t PROGMEM ledmap_indices[LEDMAP_LAYER_COUNT][(LEDMAP_LED_COUNT + 1) / 2] = {',
+    ]
+    for layer, frame in enumerate(frames):
+        packed = ', '.join(f'0x{byte:02x}' for byte in pack(frame))
+        lines.append(f'    [{layer}] = {{{packed}}},')
+    lines += [
+        '};',
+        '// clang-format on',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('ledmap', type=Path, help='ledmap.def to compile')
+    parser.add_argument('-o', '--output', type=Path, help='defaults to ledmap_frames.h next to the input')
+    args = parser.parse_args()
+
+    output = args.output or args.ledmap.with_name('ledmap_frames.h')
+    output.write_text(render(args.ledmap, parse(args.ledmap)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,267 @@
+#include "rgb_animation.h"
+#include "rgb_control.h"
+#include "timer.h"
+#ifdef RGB_COMPOSITOR_ENABLE
+#    include "rgb_compositor.h"
+#endif
+
+#define RGB_ANIMATION_NO_LED UINT8_MAX
+
+// Curves sampled every 8 steps of progress and interpolated in between
+#define CURVE_STEP_BITS 3
+
+static const uint8_t PROGMEM ease_curve[33] = {
+    0,   0,   0,   1,   2,   4,   7,   11,  16,  23,  31,  41,  54,  68,  85,  105, 128,
+    150, 170, 187, 201, 214, 224, 232, 239, 244, 248, 251, 253, 254, 255, 255, 255,
+};
+
+static const uint8_t PROGMEM sine_curve[33] = {
+    0,   1,   2,   5,   10,  15,  21,  29,  37,  47,  57,  67,  79,  90,  103, 115, 127,
+    140, 152, 165, 176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254, 255,
+};
+
+static const rgb_keyframe_t PROGMEM fade_keyframes[] = {
+    {255, 0, RGB_CURVE_LINEAR},
+    {0, 255, RGB_CURVE_EASE},
+};
+
+static const rgb_keyframe_t PROGMEM breathe_keyframes[] = {
+    {0, 0, RGB_CURVE_LINEAR},
+    {255, 128, RGB_CURVE_SINE},
+    {0, 127, RGB_CURVE_SINE},
+};
+
+// Quick rise and a longer fall
+static const rgb_keyframe_t PROGMEM pulse_keyframes[] = {
+    {0, 0, RGB_CURVE_LINEAR},
+    {255, 64, RGB_CURVE_EASE},
+    {0, 191, RGB_CURVE_EASE},
+};
+
+static const rgb_keyframe_t PROGMEM transition_keyframes[] = {
+    {0, 0, RGB_CURVE_LINEAR},
+    {255, 255, RGB_CURVE_EASE},
+};
+
+typedef struct {
+    const rgb_keyframe_t *keyframes;
+    RGB                   from;
+    RGB                   to;
+    uint16_t              period;
+    // Timer value when the current keyframe started
+    uint16_t start;
+    uint8_t  led;
+    uint8_t  count;
+    uint8_t  frame;
+    // Level the current keyframe starts from
+    uint8_t level;
+    uint8_t loops;
+} rgb_animation_slot_t;
+
+rgb_animation_slot_t rgb_animation_slots[RGB_ANIMATION_SLOTS] = {
+    [0 ... RGB_ANIMATION_SLOTS - 1] = {.led = RGB_ANIMATION_NO_LED},
+};
+
+// Timer value when the animations were paused
+uint16_t rgb_animation_paused_at = 0;
+bool     rgb_animation_paused    = false;
+
+// Time the animations run on, stopped while they are paused
+static uint16_t animation_clock(void) {
+    return rgb_animation_paused ? rgb_animation_paused_at : timer_read();
+}
+
+static rgb_animation_slot_t *slot_of(uint8_t led_index) {
+    for (uint8_t i = 0; i < RGB_ANIMATION_SLOTS; i++) {
+        if (rgb_animation_slots[i].led == led_index) {
+            return &rgb_animation_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t curve_at(uint8_t curve, uint8_t progress) {
+    const uint8_t *samples;
+    switch (curve) {
+        case RGB_CURVE_EASE:
+            samples = ease_curve;
+            break;
+        case RGB_CURVE_SINE:
+            samples = sine_curve;
+            break;
+        default:
+            return progress;
+    }
+    uint8_t index = progress >> CURVE_STEP_BITS;
+    uint8_t frac  = progress & ((1 << CURVE_STEP_BITS) - 1);
+    uint8_t low   = pgm_read_byte(&samples[index]);
+    uint8_t high  = pgm_read_byte(&samples[index + 1]);
+    return low + (((high - low) * frac) >> CURVE_STEP_BITS);
+}
+
+static uint8_t mix8(uint8_t a, uint8_t b, uint8_t level) {
+    return (a * (255 - level) + b * level + 127) / 255;
+}
+
+static uint16_t keyframe_duration(const rgb_animation_slot_t *slot, uint8_t frame) {
+    return (uint32_t)slot->period * pgm_read_byte(&slot->keyframes[frame].span) / 255;
+}
+
+bool rgb_animation_start(uint8_t led_index, const rgb_keyframe_t *keyframes, uint8_t count,
+                         RGB from, RGB to, uint16_t period, uint8_t loops) {
+    rgb_animation_slot_t *slot = slot_of(led_index);
+    if (slot == NULL) {
+        slot = slot_of(RGB_ANIMATION_NO_LED);
+    }
+    if (slot == NULL || count == 0) {
+        return false;
+    }
+    slot->keyframes = keyframes;
+    slot->count     = count;
+    slot->from      = from;
+    slot->to        = to;
+    slot->period    = period;
+    slot->loops     = loops;
+    slot->frame     = 0;
+    slot->level     = pgm_read_byte(&keyframes[0].level);
+    slot->start     = animation_clock();
+    slot->led       = led_index;
+
+    uint32_t total = 0;
+    for (uint8_t frame = 0; frame < count; frame++) {
+        total += keyframe_duration(slot, frame);
+    }
+    if (total == 0) {
+        // A loop taking no time would never let a frame finish
+        slot->loops = 1;
+    }
+    return true;
+}
+
+void rgb_animation_stop(uint8_t led_index) {
+    rgb_animation_slot_t *slot = slot_of(led_index);
+    if (slot == NULL) {
+        return;
+    }
+    slot->led = RGB_ANIMATION_NO_LED;
+#ifdef RGB_COMPOSITOR_ENABLE
+    rgb_compositor_clear(RGB_PLANE_EFFECT, led_index);
+#else
+    rgb_control_set_color(led_index, 0, 0, 0);
+#endif
+}
+
+void rgb_animation_pause(void) {
+    if (!rgb_animation_paused) {
+        rgb_animation_paused_at = timer_read();
+        rgb_animation_paused    = true;
+    }
+}
+
+void rgb_animation_resume(void) {
+    if (!rgb_animation_paused) {
+        return;
+    }
+    uint16_t paused = timer_read() - rgb_animation_paused_at;
+    for (uint8_t i = 0; i < RGB_ANIMATION_SLOTS; i++) {
+        rgb_animation_slots[i].start += paused;
+    }
+    rgb_animation_paused = false;
+}
+
+bool rgb_animation_running(uint8_t led_index) {
+    return slot_of(led_index) != NULL;
+}
+
+bool rgb_animation_fade(uint8_t led_index, RGB color, uint16_t duration) {
+    RGB off = {0, 0, 0};
+    return rgb_animation_start(led_index, fade_keyframes, 2, off, color, duration, 1);
+}
+
+bool rgb_animation_breathe(uint8_t led_index, RGB color, uint16_t period) {
+    RGB off = {0, 0, 0};
+    return rgb_animation_start(led_index, breathe_keyframes, 3, off, color, period,
+                               RGB_ANIMATION_FOREVER);
+}
+
+bool rgb_animation_pulse(uint8_t led_index, RGB color, uint16_t period, uint8_t n_times) {
+    RGB off = {0, 0, 0};
+    if (n_times == 0) {
+        return false;
+    }
+    return rgb_animation_start(led_index, pulse_keyframes, 3, off, color, period, n_times);
+}
+
+bool rgb_animation_transition(uint8_t led_index, RGB from, RGB to, uint16_t duration) {
+    return rgb_animation_start(led_index, transition_keyframes, 2, from, to, duration, 1);
+}
+
+/**
+ * Moves the slot past the keyframes that ended by `now` and returns the level it is at, clearing
+ * `running` once the last loop ended.
+ */
+static uint8_t animation_level(rgb_animation_slot_t *slot, uint16_t now, bool *running) {
+    uint16_t elapsed  = now - slot->start;
+    uint16_t duration = keyframe_duration(slot, slot->frame);
+    while (elapsed >= duration) {
+        slot->level = pgm_read_byte(&slot->keyframes[slot->frame].level);
+        slot->start += duration;
+        elapsed -= duration;
+
+        if (++slot->frame == slot->count) {
+            if (slot->loops == 1) {
+                *running = false;
+                return slot->level;
+            }
+            if (slot->loops != RGB_ANIMATION_FOREVER) {
+                slot->loops--;
+            }
+            slot->frame = 0;
+        }
+        duration = keyframe_duration(slot, slot->frame);
+    }
+
+    const rgb_keyframe_t *keyframe = &slot->keyframes[slot->frame];
+    uint8_t               progress = (uint32_t)elapsed * 255 / duration;
+    uint8_t               eased    = curve_at(pgm_read_byte(&keyframe->curve), progress);
+    *running                       = true;
+    return mix8(slot->level, pgm_read_byte(&keyframe->level), eased);
+}
+
+static void paint_level(const rgb_animation_slot_t *slot, uint8_t level) {
+#ifdef RGB_COMPOSITOR_ENABLE
+    if (slot->from.r == 0 && slot->from.g == 0 && slot->from.b == 0) {
+        // Coming from off, the level is how much the color covers the planes below
+        rgb_compositor_set(RGB_PLANE_EFFECT, slot->led, slot->to, level);
+        return;
+    }
+#endif
+    RGB color = {
+        .r = mix8(slot->from.r, slot->to.r, level),
+        .g = mix8(slot->from.g, slot->to.g, level),
+        .b = mix8(slot->from.b, slot->to.b, level),
+    };
+#ifdef RGB_COMPOSITOR_ENABLE
+    rgb_compositor_set(RGB_PLANE_EFFECT, slot->led, color, UINT8_MAX);
+#else
+    rgb_control_set_color(slot->led, color.r, color.g, color.b);
+#endif
+}
+
+void manage_animations(void) {
+    uint16_t now = timer_read();
+    for (uint8_t i = 0; i < RGB_ANIMATION_SLOTS; i++) {
+        rgb_animation_slot_t *slot = &rgb_animation_slots[i];
+        if (slot->led == RGB_ANIMATION_NO_LED) {
+            continue;
+        }
+
+        bool    running = true;
+        uint8_t level   = animation_level(slot, now, &running);
+        paint_level(slot, level);
+        if (!running) {
+            // Keeps its last color until something else paints the LED
+            slot->led = RGB_ANIMATION_NO_LED;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef RGB_ANIMATION
+#define RGB_ANIMATION
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "color.h"
+#include "progmem.h"
+
+/**
+ * \file
+ *
+ * \defgroup rgb_animation Keyframe animations for single keys, painted through rgb_control.
+ *
+ * An animation mixes two colors of its LED, `from` at level 0 and `to` at level 255. Each keyframe
+ * moves the level to its own over a share of the animation period, following a curve. Everything
+ * is integer math over small lookup tables, cheap enough for every rgb_matrix_indicators_user call.
+ */
+
+/// LEDs animated at the same time
+#ifndef RGB_ANIMATION_SLOTS
+#    define RGB_ANIMATION_SLOTS 8
+#endif
+
+/// Loop count that never runs out
+#define RGB_ANIMATION_FOREVER 0
+
+typedef enum {
+    RGB_CURVE_LINEAR,
+    RGB_CURVE_EASE,  ///< Cubic ease in and out
+    RGB_CURVE_SINE,  ///< Half a cosine wave, the natural breathing curve
+} rgb_curve_t;
+
+typedef struct {
+    uint8_t level;  ///< Mix between `from` (0) and `to` (255) reached at the end of the keyframe
+    uint8_t span;   ///< Length as a share of the period, in 255ths
+    uint8_t curve;  ///< rgb_curve_t
+} rgb_keyframe_t;
+
+/**
+ * \brief Starts animating an LED, replacing whatever animation it had
+ *
+ * `keyframes` live in PROGMEM and the first one usually has a span of 0 to set the starting level.
+ * The sequence plays `loops` times, or forever with RGB_ANIMATION_FOREVER. Returns false when
+ * every slot is taken.
+ */
+bool rgb_animation_start(uint8_t led_index, const rgb_keyframe_t *keyframes, uint8_t count,
+                         RGB from, RGB to, uint16_t period, uint8_t loops);
+
+/**
+ * \brief Stops the animation of an LED and turns it off
+ */
+void rgb_animation_stop(uint8_t led_index);
+
+bool rgb_animation_running(uint8_t led_index);
+
+/**
+ * \brief Stops time for the animations while manage_animations is not called
+ */
+void rgb_animation_pause(void);
+
+/**
+ * \brief Picks the animations up where rgb_animation_pause left them
+ */
+void rgb_animation_resume(void);
+
+/// Fades `color` out over `duration` ms
+bool rgb_animation_fade(uint8_t led_index, RGB color, uint16_t duration);
+/// Breathes `color` in and out every `period` ms until stopped
+bool rgb_animation_breathe(uint8_t led_index, RGB color, uint16_t period);
+/// Pulses `color` `n_times`, each pulse lasting `period` ms
+bool rgb_animation_pulse(uint8_t led_index, RGB color, uint16_t period, uint8_t n_times);
+/// Moves from one color to another over `duration` ms and keeps the second one
+bool rgb_animation_transition(uint8_t led_index, RGB from, RGB to, uint16_t duration);
+
+/**
+ * \brief Paints the animated keys, called from rgb_matrix_indicators_user before rgb_control_flush
+ */
+void manage_animations(void);
+#endif
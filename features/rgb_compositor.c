@@ -0,0 +1,130 @@
+#include "rgb_compositor.h"
+#include "info_config.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+
+#define LED_WORDS ((RGB_MATRIX_LED_COUNT + 31) / 32)
+
+typedef struct {
+    RGB     color;
+    uint8_t alpha;
+} rgb_pixel_t;
+
+rgb_pixel_t rgb_planes[RGB_PLANE_COUNT][RGB_MATRIX_LED_COUNT] = {};
+// LEDs a plane changed that were not blended again yet
+uint32_t rgb_planes_dirty[LED_WORDS] = {};
+// Last blend of each LED, and whether any plane covers it
+RGB      rgb_composed[RGB_MATRIX_LED_COUNT] = {};
+uint32_t rgb_composed_covered[LED_WORDS]    = {};
+// Mode of the last compose, switching modes composes every LED again
+uint8_t rgb_planes_mode = RGB_MATRIX_NONE;
+
+static void mark_dirty(uint8_t index) {
+    rgb_planes_dirty[index / 32] |= 1UL << (index % 32);
+}
+
+static uint8_t mix8(uint8_t a, uint8_t b, uint8_t level) {
+    return (a * (255 - level) + b * level + 127) / 255;
+}
+
+void rgb_compositor_set(uint8_t plane, uint8_t index, RGB color, uint8_t alpha) {
+    if (plane >= RGB_PLANE_COUNT || index >= RGB_MATRIX_LED_COUNT) {
+        return;
+    }
+    rgb_pixel_t *pixel = &rgb_planes[plane][index];
+    if (alpha == 0) {
+        color = (RGB){0, 0, 0};
+    }
+    if (pixel->alpha == alpha && pixel->color.r == color.r && pixel->color.g == color.g &&
+        pixel->color.b == color.b) {
+        return;
+    }
+    pixel->color = color;
+    pixel->alpha = alpha;
+    mark_dirty(index);
+}
+
+void rgb_compositor_clear(uint8_t plane, uint8_t index) {
+    RGB off = {0, 0, 0};
+    rgb_compositor_set(plane, index, off, 0);
+}
+
+void rgb_compositor_clear_plane(uint8_t plane) {
+    for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        rgb_compositor_clear(plane, i);
+    }
+}
+
+/**
+ * Blends the planes of one LED into `color`, returns false when every plane is transparent there.
+ */
+static bool blend(uint8_t index, RGB *color) {
+    // Nothing below the highest opaque plane shows
+    uint8_t bottom = 0;
+    for (uint8_t plane = RGB_PLANE_COUNT; plane-- > 0;) {
+        if (rgb_planes[plane][index].alpha == UINT8_MAX) {
+            bottom = plane;
+            break;
+        }
+    }
+
+    bool covered = false;
+    *color       = (RGB){0, 0, 0};
+    for (uint8_t plane = bottom; plane < RGB_PLANE_COUNT; plane++) {
+        const rgb_pixel_t *pixel = &rgb_planes[plane][index];
+        if (pixel->alpha == 0) {
+            continue;
+        }
+        covered  = true;
+        color->r = mix8(color->r, pixel->color.r, pixel->alpha);
+        color->g = mix8(color->g, pixel->color.g, pixel->alpha);
+        color->b = mix8(color->b, pixel->color.b, pixel->alpha);
+    }
+    return covered;
+}
+
+void rgb_compositor_compose(void) {
+    uint8_t mode = rgb_matrix_get_mode();
+    // Effects repaint every LED on every frame, only RGB_MATRIX_NONE keeps what was painted
+    bool repaint = mode != RGB_MATRIX_NONE;
+    if (mode != rgb_planes_mode) {
+        rgb_planes_mode = mode;
+        for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+            mark_dirty(i);
+        }
+    }
+
+    uint8_t budget = RGB_COMPOSITOR_LED_BUDGET;
+    for (uint8_t word = 0; word < LED_WORDS; word++) {
+        for (uint32_t bits = rgb_planes_dirty[word]; bits; bits &= bits - 1) {
+            if (RGB_COMPOSITOR_LED_BUDGET && budget == 0) {
+                // The rest is blended on the next frames
+                break;
+            }
+            budget--;
+            uint8_t  i   = word * 32 + __builtin_ctz(bits);
+            uint32_t bit = bits & -bits;
+            rgb_planes_dirty[word] &= ~bit;
+            if (blend(i, &rgb_composed[i])) {
+                rgb_composed_covered[word] |= bit;
+                rgb_control_set_color(i, rgb_composed[i].r, rgb_composed[i].g, rgb_composed[i].b);
+            } else {
+                rgb_composed_covered[word] &= ~bit;
+                if (!repaint) {
+                    // Nothing paints over it any more
+                    rgb_control_set_color(i, 0, 0, 0);
+                }
+            }
+        }
+    }
+    if (!repaint) {
+        return;
+    }
+    // The effect overwrote the covered LEDs, they go out again without blending
+    for (uint8_t word = 0; word < LED_WORDS; word++) {
+        for (uint32_t bits = rgb_composed_covered[word]; bits; bits &= bits - 1) {
+            uint8_t i = word * 32 + __builtin_ctz(bits);
+            rgb_control_set_color(i, rgb_composed[i].r, rgb_composed[i].g, rgb_composed[i].b);
+        }
+    }
+}
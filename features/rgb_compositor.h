@@ -0,0 +1,54 @@
+#ifndef RGB_COMPOSITOR
+#define RGB_COMPOSITOR
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "color.h"
+
+/**
+ * \file
+ *
+ * \defgroup rgb_compositor Stacks the indicator passes into one frame for rgb_control.
+ *
+ * Each pass paints its own plane instead of the LEDs. Every LED of a plane has a color and an
+ * alpha, 0 leaving the planes below visible. rgb_compositor_compose blends the planes from the
+ * bottom up, only for LEDs some plane changed, and hands one color per LED to rgb_control. LEDs
+ * left transparent on every plane are not painted, so a running effect shows through them.
+ */
+
+/// LEDs blended per compose, the others wait for the next frames. 0 blends them all at once
+#ifndef RGB_COMPOSITOR_LED_BUDGET
+#    define RGB_COMPOSITOR_LED_BUDGET 0
+#endif
+
+typedef enum {
+    RGB_PLANE_BASE,    ///< Layer colors
+    RGB_PLANE_OVERLAY, ///< Colors of single keys on some layers, transparent elsewhere
+    RGB_PLANE_EFFECT,  ///< Blinking and animated keys
+    RGB_PLANE_HOST,    ///< Colors sent by the host, above everything else
+    RGB_PLANE_COUNT,
+} rgb_plane_t;
+
+/**
+ * \brief Paints one LED of a plane, `alpha` 255 hides the planes below and 0 is transparent
+ */
+void rgb_compositor_set(uint8_t plane, uint8_t index, RGB color, uint8_t alpha);
+
+/**
+ * \brief Makes one LED of a plane transparent
+ */
+void rgb_compositor_clear(uint8_t plane, uint8_t index);
+
+/**
+ * \brief Makes every LED of a plane transparent
+ */
+void rgb_compositor_clear_plane(uint8_t plane);
+
+/**
+ * \brief Blends the planes into the rgb_control frame, called before rgb_control_flush
+ *
+ * Only LEDs some plane changed are blended, up to RGB_COMPOSITOR_LED_BUDGET of them. While an
+ * effect runs every covered LED is painted again from its last blend, as the effect overwrote it.
+ */
+void rgb_compositor_compose(void);
+#endif
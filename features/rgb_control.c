@@ -3,15 +3,228 @@
 #include "debug.h"
 #include "info_config.h"
 #include "rgb_matrix.h"
+#include "timer.h"
+#ifdef RGB_COMPOSITOR_ENABLE
+#    include "rgb_compositor.h"
+#endif
 
-RGB      color_map[RGB_MATRIX_LED_COUNT]             = {};
-uint32_t blink_interval[RGB_MATRIX_LED_COUNT]        = {};
-uint32_t blink_timer_deadlines[RGB_MATRIX_LED_COUNT] = {};
-uint32_t blink_counters[RGB_MATRIX_LED_COUNT]        = {};
-uint32_t blink_ntimes_limit[RGB_MATRIX_LED_COUNT]    = {};
+#define LED_WORDS ((RGB_MATRIX_LED_COUNT + 31) / 32)
+
+_Static_assert(RGB_MATRIX_LED_COUNT <= 64, "enable_blinking_for_mask takes a 64-bit LED mask");
+
+/**
+ * Blinking LEDs sharing one interval, they turn on and off together.
+ *
+ * `deadline` is a 16-bit timer value and is only ever compared through its difference to the
+ * current time, so it keeps working across timer wraps for intervals up to 32 s. That difference
+ * is only right while frames run at least every 32 s, the deadlines are reset after a longer gap.
+ */
+typedef struct {
+    uint16_t interval;
+    uint16_t deadline;
+    uint32_t members[LED_WORDS];
+} blink_group_t;
+
+/// Blink state of one LED, the phase belongs to its group
+typedef struct {
+    uint16_t count;
+    uint16_t limit;
+    RGB      color;
+    uint8_t  group;
+} blink_state_t;
+
+#define BLINK_NO_GROUP UINT8_MAX
+
+blink_group_t blink_groups[RGB_BLINK_GROUP_COUNT] = {};
+blink_state_t blink_states[RGB_MATRIX_LED_COUNT]  = {};
+
+// LEDs that left their group and are turned off on the next frame
+uint32_t blink_pending_off[LED_WORDS] = {};
+// Earliest time a group changes, while waiting frames before it have nothing to do
+uint16_t blink_next_change = 0;
+bool     blink_waiting     = false;
+
+// What the indicator pass wants on each LED, pushed to the driver by rgb_control_flush
+RGB      rgb_shadow[RGB_MATRIX_LED_COUNT] = {};
+uint32_t rgb_shadow_dirty[LED_WORDS]      = {};
+uint32_t rgb_shadow_touched[LED_WORDS]    = {};
+// LEDs ever painted, the others belong to the effect and are never written
+uint32_t rgb_shadow_painted[LED_WORDS] = {};
+// LEDs the last flush repainted over an effect, pushed again by rgb_control_repeat
+uint32_t rgb_shadow_repeat[LED_WORDS] = {};
+// The driver buffer no longer matches the shadow, the next flush pushes every painted LED
+bool    rgb_shadow_stale   = true;
+uint8_t rgb_shadow_mode    = RGB_MATRIX_NONE;
+bool    rgb_shadow_enabled = false;
+// Scale of everything pushed to the driver, and the one the driver buffer was last written with
+// after the power budget
+uint8_t rgb_output_level = UINT8_MAX;
+uint8_t rgb_flush_level  = UINT8_MAX;
+// Sum of every channel of the shadow, the estimated current in 255ths of RGB_POWER_CHANNEL_MA
+uint32_t rgb_power_sum = 0;
+// Level the power budget allows, and the headroom it needs before it is raised again
+uint8_t rgb_power_level = UINT8_MAX;
+#define RGB_POWER_LEVEL_STEP 16
+// Timer value when blinking was paused
+uint32_t blink_paused_at = 0;
+bool     blink_paused    = false;
+// Last time the deadlines were looked at, a longer gap than the 16-bit deadlines span loses
+// their order
+uint32_t blink_checked_at = 0;
 
 bool rgb_control_init = false;
 
+// Signed ms from `time` until `deadline`, negative once it passed
+static int16_t blink_time_until(uint16_t deadline, uint16_t time) {
+    return (int16_t)(deadline - time);
+}
+
+// Time the blink groups run on, stopped while blinking is paused
+static uint16_t blink_clock(void) {
+    return blink_paused ? (uint16_t)blink_paused_at : timer_read();
+}
+
+static void set_led_bit(uint32_t *bits, uint8_t led_index, bool set) {
+    if (set) {
+        bits[led_index / 32] |= 1UL << (led_index % 32);
+    } else {
+        bits[led_index / 32] &= ~(1UL << (led_index % 32));
+    }
+}
+
+// With the compositor an LED that is off shows whatever the planes below have
+static void paint_blink(uint8_t led_index, bool lit) {
+    RGB color = blink_states[led_index].color;
+#ifdef RGB_COMPOSITOR_ENABLE
+    if (lit) {
+        rgb_compositor_set(RGB_PLANE_EFFECT, led_index, color, UINT8_MAX);
+    } else {
+        rgb_compositor_clear(RGB_PLANE_EFFECT, led_index);
+    }
+#else
+    if (lit) {
+        rgb_control_set_color(led_index, color.r, color.g, color.b);
+    } else {
+        rgb_control_set_color(led_index, 0, 0, 0);
+    }
+#endif
+}
+
+static bool group_is_empty(const blink_group_t *group) {
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        if (group->members[word]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void rgb_control_set_color(uint8_t index, uint8_t red, uint8_t green, uint8_t blue) {
+    RGB *shadow = &rgb_shadow[index];
+    if (shadow->r != red || shadow->g != green || shadow->b != blue) {
+        rgb_power_sum += red + green + blue;
+        rgb_power_sum -= shadow->r + shadow->g + shadow->b;
+        shadow->r = red;
+        shadow->g = green;
+        shadow->b = blue;
+        set_led_bit(rgb_shadow_dirty, index, true);
+    }
+    set_led_bit(rgb_shadow_touched, index, true);
+    set_led_bit(rgb_shadow_painted, index, true);
+}
+
+void rgb_control_set_color_all(uint8_t red, uint8_t green, uint8_t blue) {
+    for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        rgb_control_set_color(i, red, green, blue);
+    }
+}
+
+void rgb_control_invalidate(void) {
+    rgb_shadow_stale = true;
+}
+
+void rgb_control_set_level(uint8_t level) {
+    rgb_output_level = level;
+}
+
+// Highest level keeping the frame within RGB_POWER_BUDGET_MA
+static uint8_t power_level(void) {
+    // Both in 255ths of a mA, the frame at full level against the budget
+    uint32_t full   = rgb_power_sum * RGB_POWER_CHANNEL_MA;
+    uint32_t budget = (uint32_t)RGB_POWER_BUDGET_MA * UINT8_MAX;
+    uint8_t  level  = UINT8_MAX;
+    if (RGB_POWER_BUDGET_MA != 0 && full > budget) {
+        level = budget * UINT8_MAX / full;
+    }
+    // Lowered right away to stay within the budget, but only raised by whole steps, so a blinking
+    // LED does not push every painted LED again each time it turns off
+    if (level < rgb_power_level || level == UINT8_MAX ||
+        level - rgb_power_level >= RGB_POWER_LEVEL_STEP) {
+        rgb_power_level = level;
+    }
+    return rgb_power_level;
+}
+
+static uint8_t scale_output(uint8_t value) {
+    return value * rgb_flush_level / UINT8_MAX;
+}
+
+void rgb_control_flush(void) {
+    uint8_t mode    = rgb_matrix_get_mode();
+    bool    enabled = rgb_matrix_is_enabled();
+    // Switching to RGB_MATRIX_NONE or toggling the matrix clears the driver buffer behind our back
+    if (mode != rgb_shadow_mode || enabled != rgb_shadow_enabled) {
+        rgb_shadow_mode    = mode;
+        rgb_shadow_enabled = enabled;
+        rgb_shadow_stale   = true;
+    }
+    uint8_t level = power_level();
+    if (rgb_output_level < level) {
+        level = rgb_output_level;
+    }
+    if (level != rgb_flush_level) {
+        // Dimmed evenly, every painted LED goes out again
+        rgb_flush_level  = level;
+        rgb_shadow_stale = true;
+    }
+    // Effects repaint every LED on every frame, so whatever was painted this frame goes out again
+    bool repaint = mode != RGB_MATRIX_NONE;
+
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        uint32_t bits = rgb_shadow_dirty[word];
+        if (repaint) {
+            // What was not painted this frame shows the effect, the shadow is stale there
+            bits = rgb_shadow_touched[word];
+        } else if (rgb_shadow_stale) {
+            bits = rgb_shadow_painted[word];
+        }
+        for (; bits; bits &= bits - 1) {
+            size_t i = word * 32 + __builtin_ctz(bits);
+            if (i >= RGB_MATRIX_LED_COUNT) {
+                break;
+            }
+            if (rgb_flush_level == UINT8_MAX) {
+                rgb_matrix_set_color(i, rgb_shadow[i].r, rgb_shadow[i].g, rgb_shadow[i].b);
+            } else {
+                RGB shadow = rgb_shadow[i];
+                rgb_matrix_set_color(i, scale_output(shadow.r), scale_output(shadow.g),
+                                     scale_output(shadow.b));
+            }
+        }
+        rgb_shadow_repeat[word]  = rgb_shadow_touched[word];
+        rgb_shadow_dirty[word]   = 0;
+        rgb_shadow_touched[word] = 0;
+    }
+    rgb_shadow_stale = false;
+}
+
+void rgb_control_repeat(void) {
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        rgb_shadow_touched[word] |= rgb_shadow_repeat[word];
+    }
+    rgb_control_flush();
+}
+
 void init_rgb_state(void) {
     if (rgb_control_init) {
         return;
@@ -23,90 +236,234 @@ void init_rgb_state(void) {
 void disable_all()
 {
     RGB off = {0, 0, 0};
+    for (size_t i = 0; i < RGB_BLINK_GROUP_COUNT; i++) {
+        for (size_t word = 0; word < LED_WORDS; word++) {
+            blink_groups[i].members[word] = 0;
+        }
+    }
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        blink_pending_off[word] = 0;
+    }
+    blink_waiting = false;
     for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
-        color_map[i]             = off;
-        blink_counters[i]        = 0;
-        blink_interval[i]        = UINT32_MAX;
-        blink_timer_deadlines[i] = UINT32_MAX;
-        blink_ntimes_limit[i]    = UINT32_MAX;
-        rgb_matrix_set_color(i, 0, 0, 0);
+        blink_states[i].color = off;
+        blink_states[i].count = 0;
+        blink_states[i].limit = RGB_BLINK_FOREVER;
+        blink_states[i].group = BLINK_NO_GROUP;
+        paint_blink(i, false);
     }
 }
 
-uint32_t synch_with_closest_blink(uint16_t interval, uint32_t time) {
-    uint32_t closest_deadline = UINT32_MAX;
-    for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
-        uint32_t deadline = blink_timer_deadlines[i];
-        if (blink_interval[i] == interval) {
-            return deadline;
+/**
+ * Makes every group due when the deadlines were not looked at for longer than they can be ahead.
+ * A passed deadline would read as one in the future then, and freeze its group for up to 32 s.
+ */
+static void blink_check_deadlines(void) {
+    if (blink_paused) {
+        // Time stands still for the groups, resume_blinking moves the deadlines by the pause
+        return;
+    }
+    uint32_t now = timer_read32();
+    if (now - blink_checked_at > INT16_MAX) {
+        for (size_t i = 0; i < RGB_BLINK_GROUP_COUNT; i++) {
+            blink_groups[i].deadline = (uint16_t)now - 1;
+        }
+        blink_waiting = false;
+    }
+    blink_checked_at = now;
+}
+
+/**
+ * Finds the group blinking with `interval`, or sets up a free one in phase with the group that
+ * changes next. Returns BLINK_NO_GROUP when every group is taken by another interval.
+ */
+static uint8_t blink_group_for(uint16_t interval, uint16_t time) {
+    uint8_t free_group    = BLINK_NO_GROUP;
+    uint8_t closest_group = BLINK_NO_GROUP;
+    int16_t closest       = INT16_MAX;
+    for (uint8_t i = 0; i < RGB_BLINK_GROUP_COUNT; i++) {
+        blink_group_t *group = &blink_groups[i];
+        if (group_is_empty(group)) {
+            if (free_group == BLINK_NO_GROUP) {
+                free_group = i;
+            }
+            continue;
+        }
+        if (group->interval == interval) {
+            return i;
         }
 
-        if (deadline < closest_deadline) {
-            closest_deadline = deadline;
+        int16_t until = blink_time_until(group->deadline, time);
+        if (until < closest) {
+            closest       = until;
+            closest_group = i;
         }
     }
-    if (closest_deadline == UINT32_MAX) {
-        return time;
+
+    if (free_group == BLINK_NO_GROUP) {
+        dprintf("No blink group left for interval %u\n", interval);
+        return BLINK_NO_GROUP;
     }
-    return closest_deadline;
+
+    blink_groups[free_group].interval = interval;
+    blink_groups[free_group].deadline =
+        closest_group == BLINK_NO_GROUP ? time : blink_groups[closest_group].deadline;
+    return free_group;
 }
 
-void enable_blinking_for(uint8_t key_index, RGB color, uint32_t interval, uint32_t n_times) {
-    blink_timer_deadlines[key_index] = synch_with_closest_blink(interval, timer_read32());
-    color_map[key_index]             = color;
-    blink_interval[key_index]        = interval;
-    blink_ntimes_limit[key_index]    = n_times;
-    blink_counters[key_index]        = 0;
+static void leave_group(uint8_t led_index) {
+    uint8_t group = blink_states[led_index].group;
+    if (group != BLINK_NO_GROUP) {
+        set_led_bit(blink_groups[group].members, led_index, false);
+        blink_states[led_index].group = BLINK_NO_GROUP;
+    }
+}
+
+static void join_group(uint8_t led_index, uint8_t group, RGB color, uint16_t n_times) {
+    blink_state_t *state = &blink_states[led_index];
+    leave_group(led_index);
+    state->color = color;
+    state->limit = n_times;
+    state->count = 0;
+    state->group = group;
+    set_led_bit(blink_groups[group].members, led_index, true);
+    set_led_bit(blink_pending_off, led_index, false);
+}
+
+bool enable_blinking_for(uint8_t key_index, RGB color, uint16_t interval, uint16_t n_times) {
+    return enable_blinking_for_mask(1ULL << key_index, color, interval, n_times);
+}
+
+bool enable_blinking_for_mask(uint64_t led_mask, RGB color, uint16_t interval, uint16_t n_times) {
+    if (led_mask == 0) {
+        return true;
+    }
+    blink_check_deadlines();
+    uint8_t group = blink_group_for(interval, blink_clock());
+    if (group == BLINK_NO_GROUP) {
+        return false;
+    }
+    for (; led_mask; led_mask &= led_mask - 1) {
+        join_group(__builtin_ctzll(led_mask), group, color, n_times);
+    }
+    blink_waiting = false;
+    return true;
 }
 
 void disable_blinking_for(uint8_t key_index) {
-    RGB off                   = {0, 0, 0};
-    color_map[key_index]      = off;
-    blink_interval[key_index] = UINT32_MAX;
-    blink_counters[key_index] = 0;
+    RGB off                       = {0, 0, 0};
+    blink_states[key_index].color = off;
+    blink_states[key_index].count = 0;
+    leave_group(key_index);
+    set_led_bit(blink_pending_off, key_index, true);
+    blink_waiting = false;
+}
+
+void pause_blinking(void) {
+    if (!blink_paused) {
+        blink_paused_at = timer_read32();
+        blink_paused    = true;
+    }
+}
+
+void resume_blinking(void) {
+    if (!blink_paused) {
+        return;
+    }
+    // Deadlines only count through their difference to the timer, so shifting them by the pause
+    // modulo 2^16 is exact however long the pause was
+    uint32_t paused = timer_read32() - blink_paused_at;
+    for (size_t i = 0; i < RGB_BLINK_GROUP_COUNT; i++) {
+        blink_groups[i].deadline += paused;
+    }
+    blink_next_change += paused;
+    // The pause is not a gap between frames, the shifted deadlines are still in order
+    blink_checked_at += paused;
+    blink_paused = false;
 }
 
 bool blinking_enabled_on_led(uint8_t index) {
-    RGB  color      = color_map[index];
+    RGB  color      = blink_states[index].color;
     bool rgb_is_off = color.r == 0 && color.g == 0 && color.b == 0;
-    return blink_timer_deadlines[index] != UINT32_MAX && !rgb_is_off;
+    return blink_states[index].group != BLINK_NO_GROUP && !rgb_is_off;
 }
 
-void manage_blink_deadline(size_t led_index, uint32_t trigger_time) {
-    uint32_t count       = blink_counters[led_index];
-    uint32_t count_limit = blink_ntimes_limit[led_index];
-
-    if (count_limit != UINT32_MAX && count > count_limit) {
-        dprintf("index: %u, count: %lu, limit: %lu, deadline: %lu, interval: %lu\n", led_index,
-                count, count_limit, blink_timer_deadlines[led_index], blink_interval[led_index]);
+// Counts a blink, a LED that ran out stays lit for this frame and is turned off on the next
+static void count_blink(uint8_t led_index) {
+    blink_state_t *state = &blink_states[led_index];
+    if (state->count < UINT16_MAX) {
+        state->count += 1;
+    }
+    if (state->limit != RGB_BLINK_FOREVER && state->count > state->limit) {
+        dprintf("index: %u, count: %u, limit: %u\n", led_index, state->count, state->limit);
         disable_blinking_for(led_index);
     }
+}
 
-    uint32_t interval      = blink_interval[led_index];
-    if (interval == UINT32_MAX) {
-        blink_timer_deadlines[led_index] = UINT32_MAX;
-        return;
+/**
+ * Paints the members of one group and returns the ms until the group changes again.
+ */
+static int16_t manage_blink_group(blink_group_t *group, uint16_t trigger_time) {
+    uint16_t interval = group->interval;
+    int16_t  until    = blink_time_until(group->deadline, trigger_time);
+    if (until >= interval) {
+        // Synced to a group that changes before this one starts, nothing to paint yet
+        return until - interval;
+    }
+
+    // On from the deadline until half of the interval is left
+    bool lit = until < 0 || until >= interval / 2;
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        for (uint32_t bits = group->members[word]; bits; bits &= bits - 1) {
+            uint8_t i = word * 32 + __builtin_ctz(bits);
+            paint_blink(i, lit);
+            if (until < 0) {
+                count_blink(i);
+            }
+        }
     }
-    uint64_t next_deadline = trigger_time + interval;
-    blink_timer_deadlines[led_index] = next_deadline;
+
+    if (until < 0) {
+        group->deadline = trigger_time + interval;
+        return interval - interval / 2;
+    } else if (until >= interval / 2) {
+        return until - interval / 2;
+    }
+    return until;
 }
 
 void manage_blinking_keys(void) {
-    uint32_t trigger_time = timer_read32();
-    for (size_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
-        uint32_t deadline = blink_timer_deadlines[i];
-        RGB      rgb      = color_map[i];
-        uint16_t interval = blink_interval[i];
-        if (trigger_time > deadline) {
-            rgb_matrix_set_color(i, rgb.r, rgb.g, rgb.b);
-
-            blink_counters[i] += 1;
-            manage_blink_deadline(i, trigger_time);
-        } else if (trigger_time > deadline - interval / 2 || !blinking_enabled_on_led(i)) {
-            rgb_matrix_set_color(i, 0, 0, 0);
-        } else if (trigger_time > deadline - interval) {
-            // Should be on as it didnt reach the first half of the interval yet
-            rgb_matrix_set_color(i, rgb.r, rgb.g, rgb.b);
+    uint16_t trigger_time = timer_read();
+    blink_check_deadlines();
+    // Effects repaint every LED on every frame, only RGB_MATRIX_NONE keeps what was painted
+    bool repaint = rgb_matrix_get_mode() != RGB_MATRIX_NONE;
+    if (!repaint && blink_waiting && blink_time_until(blink_next_change, trigger_time) >= 0) {
+        return;
+    }
+
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        for (uint32_t bits = blink_pending_off[word]; bits; bits &= bits - 1) {
+            paint_blink(word * 32 + __builtin_ctz(bits), false);
+        }
+        blink_pending_off[word] = 0;
+    }
+
+    int16_t next_change = INT16_MAX;
+    for (size_t i = 0; i < RGB_BLINK_GROUP_COUNT; i++) {
+        if (group_is_empty(&blink_groups[i])) {
+            continue;
+        }
+        int16_t until = manage_blink_group(&blink_groups[i], trigger_time);
+        if (until < next_change) {
+            next_change = until;
+        }
+    }
+    for (size_t word = 0; word < LED_WORDS; word++) {
+        if (blink_pending_off[word]) {
+            // Ran out on this frame
+            next_change = 0;
         }
     }
+    blink_next_change = trigger_time + next_change;
+    blink_waiting     = true;
 }
@@ -1,6 +1,8 @@
 #ifndef RGB_CONTROL_ANIMATION
 #define RGB_CONTROL_ANIMATION
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "color.h"
 
@@ -13,10 +15,41 @@
  void init_rgb_state(void);
  void disable_all(void);
 
+/// Blink count that never runs out
+#define RGB_BLINK_FOREVER UINT16_MAX
+
+/// Distinct blink intervals at once, LEDs with the same interval share a group and its phase. A
+/// blink with yet another interval is refused until a group empties
+#ifndef RGB_BLINK_GROUP_COUNT
+#    define RGB_BLINK_GROUP_COUNT 4
+#endif
+
+/// Current budget of the painted LEDs in mA, the frame is dimmed evenly above it. 0 is no limit.
+/// LEDs left to a running effect are neither counted nor dimmed
+#ifndef RGB_POWER_BUDGET_MA
+#    define RGB_POWER_BUDGET_MA 0
+#endif
+
+/// Estimated current of one LED channel at full value in mA
+#ifndef RGB_POWER_CHANNEL_MA
+#    define RGB_POWER_CHANNEL_MA 20
+#endif
+
 /**
  * \brief Enables blinking for an individual key with its own RGB color and pulse interval
+ *
+ * The interval is in ms and must stay below 32768, blink deadlines live on the 16-bit timer.
+ * Returns false, leaving the key as it was, when RGB_BLINK_GROUP_COUNT other intervals are
+ * already blinking.
  */
-void enable_blinking_for(uint8_t key_index, RGB color, uint32_t interval, uint32_t n_times);
+bool enable_blinking_for(uint8_t key_index, RGB color, uint16_t interval, uint16_t n_times);
+
+/**
+ * \brief Enables the same blinking for every LED set in `led_mask`, bit n being LED n
+ *
+ * Returns false like enable_blinking_for, no LED of the mask starts blinking then.
+ */
+bool enable_blinking_for_mask(uint64_t led_mask, RGB color, uint16_t interval, uint16_t n_times);
 
 /**
  * \brief Disables blinking for an individual key
@@ -25,5 +58,61 @@ void disable_blinking_for(uint8_t key_index);
 
 bool blinking_enabled_on_led(uint8_t index);
 
+/**
+ * \brief Paints one LED of the indicator frame, it reaches the driver on rgb_control_flush
+ */
+void rgb_control_set_color(uint8_t index, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * \brief Paints every LED of the indicator frame
+ */
+void rgb_control_set_color_all(uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * \brief Pushes the LEDs painted since the last flush to the RGB driver
+ *
+ * Called at the end of rgb_matrix_indicators_user. With RGB_MATRIX_NONE only LEDs whose color
+ * changed are written, while an effect is running every LED painted this frame is written again.
+ * LEDs that were never painted are never written, so a running effect keeps them.
+ */
+void rgb_control_flush(void);
+
+/**
+ * \brief Flushes the last frame again, for frames the passes skip
+ *
+ * Only does work while an effect runs, or when the driver buffer was cleared.
+ */
+void rgb_control_repeat(void);
+
+/**
+ * \brief Makes the next flush write every painted LED, for when something else changed the driver
+ * buffer
+ */
+void rgb_control_invalidate(void);
+
+/**
+ * \brief Scales every LED pushed to the driver, 255 leaves the frame as painted
+ *
+ * The power budget can dim the frame further, it is estimated from the painted colors as they
+ * change and applied on top of this level.
+ */
+void rgb_control_set_level(uint8_t level);
+
+/**
+ * \brief Stops time for the blink groups while manage_blinking_keys is not called
+ */
+void pause_blinking(void);
+
+/**
+ * \brief Moves the blink deadlines by the time spent paused, every group keeps its phase
+ */
+void resume_blinking(void);
+
+/**
+ * \brief Paints the blinking keys, called from rgb_matrix_indicators_user
+ *
+ * Only the members of each blink group are visited, and with RGB_MATRIX_NONE a frame before the
+ * earliest group change returns right away.
+ */
 void manage_blinking_keys(void);
 #endif
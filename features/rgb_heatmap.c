@@ -0,0 +1,116 @@
+#include "rgb_heatmap.h"
+#include "color.h"
+#include "info_config.h"
+#include "progmem.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+#include "timer.h"
+#ifdef RGB_COMPOSITOR_ENABLE
+#    include "rgb_compositor.h"
+#endif
+
+#define HEAT_WORDS ((RGB_MATRIX_LED_COUNT + 3) / 4)
+
+// Every byte of a word with the same value
+#define BYTES(value) ((uint32_t)(value) * 0x01010101UL)
+
+// Heat sampled every 16 steps and interpolated in between
+#define HEAT_STEP_BITS 4
+
+// Hue 170 down to 0 with the value following the heat, like the stock heatmap
+static const uint8_t PROGMEM heat_colors[17][3] = {
+    {0, 0, 0},     {0, 3, 16},    {0, 15, 32},   {0, 36, 48},   {0, 63, 64},  {0, 80, 60},
+    {0, 96, 47},   {0, 112, 29},  {0, 128, 0},   {37, 144, 0},  {79, 160, 0}, {132, 176, 0},
+    {192, 189, 0}, {208, 156, 0}, {224, 111, 0}, {240, 57, 0},  {255, 0, 0},
+};
+
+// Heat of each LED, four to a word so they cool down together
+uint32_t heatmap[HEAT_WORDS] = {};
+uint32_t heatmap_decay_time  = 0;
+
+static uint8_t heat_of(uint8_t led_index) {
+    return heatmap[led_index / 4] >> (led_index % 4 * 8);
+}
+
+static void paint_heat(uint8_t led_index) {
+    uint8_t heat  = heat_of(led_index);
+    uint8_t index = heat >> HEAT_STEP_BITS;
+    uint8_t frac  = heat & ((1 << HEAT_STEP_BITS) - 1);
+    uint8_t rgb[3];
+    for (uint8_t channel = 0; channel < 3; channel++) {
+        uint8_t low  = pgm_read_byte(&heat_colors[index][channel]);
+        uint8_t high = pgm_read_byte(&heat_colors[index + 1][channel]);
+        rgb[channel] = low + (((high - low) * frac) >> HEAT_STEP_BITS);
+    }
+#ifdef RGB_COMPOSITOR_ENABLE
+    if (heat == 0) {
+        rgb_compositor_clear(RGB_HEATMAP_PLANE, led_index);
+    } else {
+        RGB color = {.r = rgb[0], .g = rgb[1], .b = rgb[2]};
+        rgb_compositor_set(RGB_HEATMAP_PLANE, led_index, color, UINT8_MAX);
+    }
+#else
+    rgb_control_set_color(led_index, rgb[0], rgb[1], rgb[2]);
+#endif
+}
+
+/**
+ * Subtracts `amount` from every byte of `heat`, stopping at 0 instead of borrowing from the next
+ * byte.
+ */
+static uint32_t cool_down(uint32_t heat, uint8_t amount) {
+    const uint32_t high = BYTES(0x80);
+    uint32_t       sub  = BYTES(amount);
+    // Byte-wise heat - sub, the top bits are left out so no borrow crosses a byte
+    uint32_t diff = ((heat | high) - (sub & ~high)) ^ ((heat ^ ~sub) & high);
+    // Borrow out of the top bit of each byte, set where the byte went below 0
+    uint32_t borrow = ((~heat & sub) | (~(heat ^ sub) & diff)) & high;
+    return diff & ~((borrow >> 7) * 0xFF);
+}
+
+void rgb_heatmap_hit(uint8_t led_index) {
+    if (led_index >= RGB_MATRIX_LED_COUNT) {
+        return;
+    }
+    uint8_t heat = heat_of(led_index);
+    if (heat > UINT8_MAX - RGB_HEATMAP_INCREMENT) {
+        heat = UINT8_MAX;
+    } else {
+        heat += RGB_HEATMAP_INCREMENT;
+    }
+
+    uint8_t shift = led_index % 4 * 8;
+    heatmap[led_index / 4] &= ~(0xFFUL << shift);
+    heatmap[led_index / 4] |= (uint32_t)heat << shift;
+    paint_heat(led_index);
+}
+
+void manage_heatmap(void) {
+    uint32_t steps = timer_elapsed32(heatmap_decay_time) / RGB_HEATMAP_DECAY_INTERVAL;
+    // Effects repaint every LED on every frame, only RGB_MATRIX_NONE keeps what was painted
+    bool repaint = rgb_matrix_get_mode() != RGB_MATRIX_NONE;
+#ifdef RGB_COMPOSITOR_ENABLE
+    // The planes keep it instead
+    repaint = false;
+#endif
+    if (steps == 0 && !repaint) {
+        return;
+    }
+    heatmap_decay_time += steps * RGB_HEATMAP_DECAY_INTERVAL;
+
+    uint8_t amount = steps >= UINT8_MAX / RGB_HEATMAP_DECAY ? UINT8_MAX : steps * RGB_HEATMAP_DECAY;
+    for (uint8_t word = 0; word < HEAT_WORDS; word++) {
+        uint32_t heat = heatmap[word];
+        if (heat == 0) {
+            // Four cold LEDs, nothing to do
+            continue;
+        }
+        heatmap[word] = cool_down(heat, amount);
+        if (heatmap[word] == heat && !repaint) {
+            continue;
+        }
+        for (uint8_t i = word * 4; i < word * 4 + 4 && i < RGB_MATRIX_LED_COUNT; i++) {
+            paint_heat(i);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef RGB_HEATMAP
+#define RGB_HEATMAP
+
+#include <stdint.h>
+
+/**
+ * \file
+ *
+ * \defgroup rgb_heatmap Typing heatmap painted through rgb_control.
+ *
+ * A lean stand-in for RGB_MATRIX_TYPING_HEATMAP: one byte of heat per LED, raised by every key
+ * press and cooled four LEDs at a time with a saturating subtract on 32-bit words. Heat goes from
+ * blue to red through a small lookup table.
+ */
+
+/// Heat added by a key press
+#ifndef RGB_HEATMAP_INCREMENT
+#    define RGB_HEATMAP_INCREMENT 32
+#endif
+
+/// Heat lost every RGB_HEATMAP_DECAY_INTERVAL ms
+#ifndef RGB_HEATMAP_DECAY
+#    define RGB_HEATMAP_DECAY 1
+#endif
+
+#ifndef RGB_HEATMAP_DECAY_INTERVAL
+#    define RGB_HEATMAP_DECAY_INTERVAL 25
+#endif
+
+/// Compositor plane the heat is painted on, when there is a compositor
+#ifndef RGB_HEATMAP_PLANE
+#    define RGB_HEATMAP_PLANE RGB_PLANE_BASE
+#endif
+
+/**
+ * \brief Heats up a key, called from post_process_record_user with the LED of the pressed key
+ */
+void rgb_heatmap_hit(uint8_t led_index);
+
+/**
+ * \brief Cools the keys down and paints the ones that changed, called from
+ * rgb_matrix_indicators_user
+ */
+void manage_heatmap(void);
+#endif
@@ -0,0 +1,126 @@
+#include "rgb_scheduler.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+#include "timer.h"
+#ifdef RGB_ANIMATION_ENABLE
+#    include "rgb_animation.h"
+#endif
+
+typedef enum {
+    RGB_SCHEDULER_ACTIVE,
+    RGB_SCHEDULER_FADING,
+    RGB_SCHEDULER_IDLE,
+} rgb_scheduler_state_t;
+
+uint8_t  rgb_scheduler_state         = RGB_SCHEDULER_ACTIVE;
+uint32_t rgb_scheduler_activity_time = 0;
+uint32_t rgb_scheduler_fade_start    = 0;
+uint32_t rgb_scheduler_frame_time    = 0;
+// Brightness of the running effect before it was dimmed with the indicator frame
+uint8_t rgb_scheduler_effect_val    = 0;
+bool    rgb_scheduler_effect_dimmed = false;
+
+static void pause_passes(void) {
+    pause_blinking();
+#ifdef RGB_ANIMATION_ENABLE
+    rgb_animation_pause();
+#endif
+}
+
+// Dims a running effect along with the indicator frame, without touching the EEPROM
+static void set_level(uint8_t level) {
+    rgb_control_set_level(level);
+    if (rgb_matrix_get_mode() == RGB_MATRIX_NONE && !rgb_scheduler_effect_dimmed) {
+        return;
+    }
+    if (!rgb_scheduler_effect_dimmed) {
+        rgb_scheduler_effect_val    = rgb_matrix_get_val();
+        rgb_scheduler_effect_dimmed = true;
+    }
+    uint8_t val = rgb_scheduler_effect_val * level / UINT8_MAX;
+    if (val != rgb_matrix_get_val()) {
+        rgb_matrix_sethsv_noeeprom(rgb_matrix_get_hue(), rgb_matrix_get_sat(), val);
+    }
+}
+
+static void wake_up(void) {
+    set_level(UINT8_MAX);
+    rgb_scheduler_effect_dimmed = false;
+    resume_blinking();
+#ifdef RGB_ANIMATION_ENABLE
+    rgb_animation_resume();
+#endif
+    rgb_scheduler_state = RGB_SCHEDULER_ACTIVE;
+}
+
+void rgb_scheduler_activity(void) {
+    rgb_scheduler_activity_time = timer_read32();
+    if (rgb_scheduler_state != RGB_SCHEDULER_ACTIVE) {
+        wake_up();
+    }
+}
+
+void rgb_scheduler_suspend(void) {
+    if (rgb_scheduler_state == RGB_SCHEDULER_ACTIVE) {
+        pause_passes();
+    }
+    rgb_scheduler_state = RGB_SCHEDULER_IDLE;
+}
+
+void rgb_scheduler_resume(void) {
+    // The driver buffer was cleared while suspended
+    rgb_control_invalidate();
+    rgb_scheduler_activity();
+}
+
+static void go_idle(void) {
+    set_level(RGB_IDLE_LEVEL);
+    rgb_control_repeat();
+    rgb_scheduler_state = RGB_SCHEDULER_IDLE;
+}
+
+static bool frame_due(uint32_t now) {
+    if (now - rgb_scheduler_frame_time < RGB_RENDER_INTERVAL) {
+        rgb_control_repeat();
+        return false;
+    }
+    rgb_scheduler_frame_time = now;
+    return true;
+}
+
+bool rgb_scheduler_render(void) {
+    uint32_t now = timer_read32();
+    switch (rgb_scheduler_state) {
+        case RGB_SCHEDULER_ACTIVE:
+            if (RGB_IDLE_TIMEOUT == 0 || now - rgb_scheduler_activity_time < RGB_IDLE_TIMEOUT) {
+                return frame_due(now);
+            }
+            // The frame fades as it was when the timeout ran out
+            pause_passes();
+            rgb_scheduler_fade_start = now;
+            rgb_scheduler_state      = RGB_SCHEDULER_FADING;
+            // fall through
+        case RGB_SCHEDULER_FADING: {
+            uint32_t elapsed = now - rgb_scheduler_fade_start;
+            if (elapsed >= RGB_IDLE_FADE_TIME) {
+                go_idle();
+                return false;
+            }
+            uint8_t level = UINT8_MAX - (UINT8_MAX - RGB_IDLE_LEVEL) * elapsed / RGB_IDLE_FADE_TIME;
+            set_level(level);
+            // The passes are paused, the frame they painted last goes out again dimmed
+            rgb_control_repeat();
+            return false;
+        }
+        default:
+            if (rgb_matrix_get_mode() != RGB_MATRIX_NONE) {
+                // The effect paints over the idle frame on every frame
+                if (RGB_IDLE_LEVEL == 0) {
+                    // Effects that ignore the brightness go dark as well
+                    rgb_matrix_set_color_all(0, 0, 0);
+                }
+                rgb_control_repeat();
+            }
+            return false;
+    }
+}
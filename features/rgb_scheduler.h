@@ -0,0 +1,63 @@
+#ifndef RGB_SCHEDULER
+#define RGB_SCHEDULER
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \file
+ *
+ * \defgroup rgb_scheduler Decides when the userspace RGB passes run.
+ *
+ * The passes run every RGB_RENDER_INTERVAL ms instead of on every RGB matrix frame. Frames in
+ * between only push the last one again over a running effect.
+ *
+ * After RGB_IDLE_TIMEOUT ms without a key event the indicator frame fades to RGB_IDLE_LEVEL and
+ * the blink and animation passes stop, picking up with the same phase on the next key event. A
+ * running effect fades along through its brightness, changed without writing the EEPROM and put
+ * back on wake up. The RGB matrix keeps running, so waking up shows the frame and the effect
+ * exactly as they were.
+ */
+
+/// Time between two frames of the passes in ms, 0 runs them on every RGB matrix frame
+#ifndef RGB_RENDER_INTERVAL
+#    define RGB_RENDER_INTERVAL 33
+#endif
+
+/// Inactivity before going idle in ms, 0 never goes idle
+#ifndef RGB_IDLE_TIMEOUT
+#    define RGB_IDLE_TIMEOUT 300000
+#endif
+
+/// Length of the fade to the idle frame in ms
+#ifndef RGB_IDLE_FADE_TIME
+#    define RGB_IDLE_FADE_TIME 2000
+#endif
+
+/// Brightness of the idle frame, 0 is dark and 255 keeps the frame as it was
+#ifndef RGB_IDLE_LEVEL
+#    define RGB_IDLE_LEVEL 0
+#endif
+
+/**
+ * \brief Wakes the passes up and restarts the idle timeout, called from process_record_user
+ */
+void rgb_scheduler_activity(void);
+
+/**
+ * \brief Goes idle right away, called from suspend_power_down_user
+ */
+void rgb_scheduler_suspend(void);
+
+/**
+ * \brief Wakes up after a suspend, called from suspend_wakeup_init_user
+ */
+void rgb_scheduler_resume(void);
+
+/**
+ * \brief Called first in rgb_matrix_indicators_user, false when the passes skip this frame
+ *
+ * A skipped frame is flushed by the scheduler itself, the dimmed one while fading.
+ */
+bool rgb_scheduler_render(void);
+#endif
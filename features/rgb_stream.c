@@ -0,0 +1,167 @@
+#include "rgb_stream.h"
+#include <string.h>
+#include "color.h"
+#include "info_config.h"
+#include "raw_hid.h"
+#include "rgb_control.h"
+#include "rgb_matrix.h"
+#ifdef RGB_COMPOSITOR_ENABLE
+#    include "rgb_compositor.h"
+#endif
+
+#define LED_WORDS ((RGB_MATRIX_LED_COUNT + 31) / 32)
+
+#define FULL_HEADER  4
+#define DELTA_HEADER 3
+#define DELTA_RUN    5
+
+typedef struct {
+    RGB      colors[RGB_MATRIX_LED_COUNT];
+    uint32_t set[LED_WORDS];
+} stream_frame_t;
+
+stream_frame_t stream_frames[2] = {};
+// Frame the reports write to, the other one is shown
+uint8_t stream_back = 0;
+// The shown frame changed and is painted on the next indicator pass
+bool stream_swapped = false;
+#ifndef RGB_COMPOSITOR_ENABLE
+// LEDs painted from the shown frame, blacked out once the host stops setting them
+uint32_t stream_painted[LED_WORDS] = {};
+#endif
+
+static void set_led(stream_frame_t *frame, uint8_t index, const uint8_t *rgb) {
+    frame->colors[index] = (RGB){.r = rgb[0], .g = rgb[1], .b = rgb[2]};
+    frame->set[index / 32] |= 1UL << (index % 32);
+}
+
+// Makes every LED of the frame transparent, once the report asking for it was checked
+static void clear_frame(stream_frame_t *frame, uint8_t flags) {
+    if (flags & RGB_STREAM_CLEAR) {
+        memset(frame->set, 0, sizeof(frame->set));
+    }
+}
+
+static uint8_t apply_full(stream_frame_t *frame, const uint8_t *data, uint8_t length) {
+    if (length < FULL_HEADER) {
+        return RGB_STREAM_BAD_LENGTH;
+    }
+    uint8_t first = data[2];
+    uint8_t count = data[3];
+    if (FULL_HEADER + 3 * count > length) {
+        return RGB_STREAM_BAD_LENGTH;
+    }
+    if (first + count > RGB_MATRIX_LED_COUNT) {
+        return RGB_STREAM_BAD_LED;
+    }
+    clear_frame(frame, data[1]);
+    for (uint8_t i = 0; i < count; i++) {
+        set_led(frame, first + i, &data[FULL_HEADER + 3 * i]);
+    }
+    return RGB_STREAM_OK;
+}
+
+static uint8_t apply_delta(stream_frame_t *frame, const uint8_t *data, uint8_t length) {
+    if (length < DELTA_HEADER) {
+        return RGB_STREAM_BAD_LENGTH;
+    }
+    uint8_t runs = data[2];
+    if (DELTA_HEADER + DELTA_RUN * runs > length) {
+        return RGB_STREAM_BAD_LENGTH;
+    }
+    // Checked before anything is written, a bad report leaves the frame alone
+    for (uint8_t run = 0; run < runs; run++) {
+        const uint8_t *entry = &data[DELTA_HEADER + DELTA_RUN * run];
+        if (entry[0] + entry[1] > RGB_MATRIX_LED_COUNT) {
+            return RGB_STREAM_BAD_LED;
+        }
+    }
+    clear_frame(frame, data[1]);
+    for (uint8_t run = 0; run < runs; run++) {
+        const uint8_t *entry = &data[DELTA_HEADER + DELTA_RUN * run];
+        for (uint8_t i = 0; i < entry[1]; i++) {
+            set_led(frame, entry[0] + i, &entry[2]);
+        }
+    }
+    return RGB_STREAM_OK;
+}
+
+static void show_back_frame(void) {
+    uint8_t shown = stream_back;
+    stream_back   = !stream_back;
+    // Delta frames build on what is shown
+    stream_frames[stream_back] = stream_frames[shown];
+    stream_swapped             = true;
+}
+
+bool rgb_stream_receive(uint8_t *data, uint8_t length) {
+    if (length < 2) {
+        return false;
+    }
+    uint8_t         command = data[0];
+    uint8_t         flags   = data[1];
+    stream_frame_t *back    = &stream_frames[stream_back];
+    uint8_t         status;
+    switch (command) {
+        case RGB_STREAM_FULL:
+        case RGB_STREAM_DELTA:
+            if (command == RGB_STREAM_FULL) {
+                status = apply_full(back, data, length);
+            } else {
+                status = apply_delta(back, data, length);
+            }
+            if (status == RGB_STREAM_OK && (flags & RGB_STREAM_END)) {
+                show_back_frame();
+            }
+            break;
+        case RGB_STREAM_RELEASE:
+            memset(stream_frames, 0, sizeof(stream_frames));
+            stream_swapped = true;
+            status         = RGB_STREAM_OK;
+            break;
+        default:
+            return false;
+    }
+
+    memset(data + 1, 0, length - 1);
+    data[1] = status;
+    raw_hid_send(data, length);
+    return true;
+}
+
+void manage_rgb_stream(void) {
+    const stream_frame_t *shown = &stream_frames[!stream_back];
+#ifndef RGB_COMPOSITOR_ENABLE
+    // Effects repaint every LED on every frame, only RGB_MATRIX_NONE keeps what was painted
+    if (rgb_matrix_get_mode() != RGB_MATRIX_NONE) {
+        stream_swapped = true;
+    }
+#endif
+    if (!stream_swapped) {
+        return;
+    }
+    stream_swapped = false;
+
+    for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        bool set = shown->set[i / 32] & (1UL << (i % 32));
+#ifdef RGB_COMPOSITOR_ENABLE
+        if (set) {
+            rgb_compositor_set(RGB_PLANE_HOST, i, shown->colors[i], UINT8_MAX);
+        } else {
+            rgb_compositor_clear(RGB_PLANE_HOST, i);
+        }
+#else
+        uint32_t bit = 1UL << (i % 32);
+        if (set) {
+            rgb_control_set_color(i, shown->colors[i].r, shown->colors[i].g, shown->colors[i].b);
+            stream_painted[i / 32] |= bit;
+        } else if (stream_painted[i / 32] & bit) {
+            // Nothing below shows through, an effect repaints the LED itself
+            stream_painted[i / 32] &= ~bit;
+            if (rgb_matrix_get_mode() == RGB_MATRIX_NONE) {
+                rgb_control_set_color(i, 0, 0, 0);
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef RGB_STREAM
+#define RGB_STREAM
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \file
+ *
+ * \defgroup rgb_stream LED frames streamed by the host over raw HID.
+ *
+ * Every report starts with a command and a flags byte:
+ *
+ *     RGB_STREAM_FULL     cmd, flags, first LED, count, count x (r, g, b)
+ *     RGB_STREAM_DELTA    cmd, flags, runs, runs x (first LED, count, r, g, b)
+ *     RGB_STREAM_RELEASE  cmd, flags
+ *
+ * Reports fill a back frame, the one shown only changes when a report with RGB_STREAM_END is
+ * applied, so a frame spread over several reports never shows half done. LEDs the host never set
+ * are transparent. Without the compositor nothing below them is kept, so LEDs the host stops
+ * setting, or every LED on RGB_STREAM_RELEASE, turn black with RGB_MATRIX_NONE and go back to the
+ * effect otherwise. Each report is answered with the command and an rgb_stream_status_t, a report
+ * refused with anything but RGB_STREAM_OK leaves the back frame as it was, RGB_STREAM_CLEAR
+ * included.
+ * features/rgb_stream.py is the host side.
+ */
+
+typedef enum {
+    RGB_STREAM_FULL    = 0xA0,
+    RGB_STREAM_DELTA   = 0xA1,
+    RGB_STREAM_RELEASE = 0xA2,
+} rgb_stream_command_t;
+
+/// Shows the back frame once this report is applied
+#define RGB_STREAM_END (1 << 0)
+/// Makes every LED of the back frame transparent before applying this report
+#define RGB_STREAM_CLEAR (1 << 1)
+
+typedef enum {
+    RGB_STREAM_OK,
+    RGB_STREAM_BAD_LENGTH,
+    RGB_STREAM_BAD_LED,
+} rgb_stream_status_t;
+
+/**
+ * \brief Handles a raw HID report, false when it is not an rgb_stream command
+ *
+ * Called from the keymap's raw_hid_receive, so the keymap can not also use Oryx or VIA, which
+ * implement raw_hid_receive themselves.
+ */
+bool rgb_stream_receive(uint8_t *data, uint8_t length);
+
+/**
+ * \brief Paints the frame shown, called from rgb_matrix_indicators_user
+ */
+void manage_rgb_stream(void);
+#endif
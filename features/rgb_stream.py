@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+# Copyright 2023 QMK
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""Drive the keyboard LEDs over raw HID, the host side of features/rgb_stream.c.
+
+Commands:
+
+    show LED=RRGGBB...   light a few LEDs, the others show the keyboard's own colors.
+                         LED is an index or a range like 0-5. Runs of LEDs with one color
+                         share an entry, so a handful of keys fit in one report.
+    frame RRGGBB...      set every LED from 0 on, in as many reports as needed.
+    release              hand the LEDs back to the keyboard.
+
+The keyboard is found through the raw HID usage page in the report descriptors of
+/sys/class/hidraw, or given with --device. --loopback runs bench/rgb_stream_loopback
+instead, which prints what the firmware code would paint.
+
+Usage:
+    python3 features/rgb_stream.py show 0-5=ff0000 24=00ff00
+    python3 features/rgb_stream.py --loopback bench/build/rgb_stream_loopback frame ff0000 00ff00
+"""
+
+import argparse
+import os
+import re
+import select
+import subprocess
+import sys
+from pathlib import Path
+
+REPORT_SIZE = 32
+# RAW_USAGE_PAGE and RAW_USAGE_ID of the keymaps, as they appear in a report descriptor
+RAW_USAGE = bytes([0x06, 0x60, 0xFF, 0x09, 0x61])
+
+FULL = 0xA0
+DELTA = 0xA1
+RELEASE = 0xA2
+
+END = 1 << 0
+CLEAR = 1 << 1
+
+STATUS = {1: 'bad length', 2: 'LED out of range'}
+
+FULL_LEDS = (REPORT_SIZE - 4) // 3
+DELTA_RUNS = (REPORT_SIZE - 3) // 5
+
+LED_RE = re.compile(r'^(\d+)(?:-(\d+))?=([0-9a-fA-F]{6})$')
+COLOR_RE = re.compile(r'^[0-9a-fA-F]{6}$')
+
+
+class Hidraw:
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR)
+
+    def transfer(self, report):
+        # No numbered reports, hidraw wants a 0 report ID first
+        os.write(self.fd, bytes([0]) + report)
+        ready, _, _ = select.select([self.fd], [], [], 1.0)
+        if not ready:
+            sys.exit('no reply from the keyboard, is RGB_STREAM_ENABLE set?')
+        return os.read(self.fd, REPORT_SIZE)
+
+
+class Loopback:
+    def __init__(self, path):
+        self.process = subprocess.Popen([path], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+    def transfer(self, report):
+        self.process.stdin.write(report)
+        self.process.stdin.flush()
+        return self.process.stdout.read(REPORT_SIZE)
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait()
+
+
+def find_keyboard():
+    for node in sorted(Path('/sys/class/hidraw').glob('hidraw*')):
+        descriptor = node / 'device' / 'report_descriptor'
+        try:
+            if RAW_USAGE in descriptor.read_bytes():
+                return Path('/dev') / node.name
+        except OSError:
+            continue
+    sys.exit('no raw HID keyboard found, give one with --device')
+
+
+def report(*fields):
+    data = bytes(fields)
+    return data + bytes(REPORT_SIZE - len(data))
+
+
+def color(text):
+    return bytes.fromhex(text)
+
+
+def show_reports(args):
+    leds = {}
+    for arg in args:
+        match = LED_RE.match(arg)
+        if not match:
+            sys.exit(f'expected LED=RRGGBB or FIRST-LAST=RRGGBB, got {arg}')
+        first = int(match.group(1))
+        last = int(match.group(2) or first)
+        for led in range(first, last + 1):
+            leds[led] = color(match.group(3))
+
+    runs = []
+    for led in sorted(leds):
+        if runs and runs[-1][0] + runs[-1][1] == led and runs[-1][2] == leds[led] and runs[-1][1] < 255:
+            runs[-1][1] += 1
+        else:
+            runs.append([led, 1, leds[led]])
+
+    reports = []
+    for start in range(0, max(len(runs), 1), DELTA_RUNS):
+        chunk = runs[start:start + DELTA_RUNS]
+        flags = (CLEAR if start == 0 else 0) | (END if start + DELTA_RUNS >= len(runs) else 0)
+        fields = [DELTA, flags, len(chunk)]
+        for first, count, rgb in chunk:
+            fields += [first, count, *rgb]
+        reports.append(report(*fields))
+    return reports
+
+
+def frame_reports(args):
+    for arg in args:
+        if not COLOR_RE.match(arg):
+            sys.exit(f'expected RRGGBB, got {arg}')
+    colors = [color(arg) for arg in args]
+    reports = []
+    for first in range(0, len(colors), FULL_LEDS):
+        chunk = colors[first:first + FULL_LEDS]
+        flags = (CLEAR if first == 0 else 0) | (END if first + FULL_LEDS >= len(colors) else 0)
+        fields = [FULL, flags, first, len(chunk)]
+        for rgb in chunk:
+            fields += list(rgb)
+        reports.append(report(*fields))
+    return reports
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    target = parser.add_mutually_exclusive_group()
+    target.add_argument('-d', '--device', type=Path, help='hidraw node of the keyboard')
+    target.add_argument('--loopback', type=Path, help='bench/build/rgb_stream_loopback to talk to instead')
+    parser.add_argument('command', choices=['show', 'frame', 'release'])
+    parser.add_argument('values', nargs='*', help='LED=RRGGBB for show, RRGGBB for frame')
+    args = parser.parse_args()
+
+    if args.command == 'show':
+        reports = show_reports(args.values)
+    elif args.command == 'frame':
+        if not args.values:
+            sys.exit('frame needs at least one color')
+        reports = frame_reports(args.values)
+    else:
+        reports = [report(RELEASE, 0)]
+
+    keyboard = Loopback(args.loopback) if args.loopback else Hidraw(args.device or find_keyboard())
+    for data in reports:
+        reply = keyboard.transfer(data)
+        if len(reply) < 2 or reply[0] != data[0]:
+            sys.exit(f'unexpected reply {reply.hex()}')
+        if reply[1]:
+            sys.exit(f'keyboard refused the report: {STATUS.get(reply[1], reply[1])}')
+    if args.loopback:
+        keyboard.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,11 @@
 #include <stdint.h>
 #include "action.h"
+#include "features/rgb_animation.h"
+#include "features/rgb_compositor.h"
 #include "features/rgb_control.h"
+#include "features/rgb_heatmap.h"
+#include "features/rgb_scheduler.h"
+#include "features/rgb_stream.h"
 #include "keycodes.h"
 #include "keymap_us.h"
 
@@ -311,8 +316,89 @@ const uint8_t PROGMEM osm_keys_led[QK_LAYERS_SUPPORTING_LEDS][QK_ONE_SHOT_MOD_CO
 };
 // clang-format on
 
+#ifdef RGB_COMPOSITOR_ENABLE
+// One-shot mod keys of the current layer, lit dimly under their blinks
+layer_state_t layer_state_set_user(layer_state_t state) {
+    uint8_t layer = get_highest_layer(state);
+    RGB     color = {0, 2, 20};
+    rgb_compositor_clear_plane(RGB_PLANE_OVERLAY);
+    if (layer < QK_LAYERS_SUPPORTING_LEDS) {
+        for (size_t i = 0; i < QK_ONE_SHOT_MOD_COUNT; i++) {
+            uint8_t osm_led = osm_keys_led[layer][i];
+            if (osm_led < RGB_MATRIX_LED_COUNT) {
+                rgb_compositor_set(RGB_PLANE_OVERLAY, osm_led, color, UINT8_MAX);
+            }
+        }
+    }
+    return state;
+}
+#endif
+
+void suspend_wakeup_init_user(void) {
+#ifdef RGB_SCHEDULER_ENABLE
+    rgb_scheduler_resume();
+#else
+    // The driver buffer was cleared while suspended
+    rgb_control_invalidate();
+#endif
+}
+
+#ifdef RGB_SCHEDULER_ENABLE
+void suspend_power_down_user(void) {
+    rgb_scheduler_suspend();
+}
+#endif
+
+#ifdef RGB_ANIMATION_ENABLE
+// LED under a key of the left half of LAYOUT_voyager, rows and columns counted from the top left
+#    define LEFT_KEY_LED(row, col) ((row) * 6 + (col))
+
+// Caps Word key on the MOD layer
+#    define CAPS_WORD_LED LEFT_KEY_LED(3, 3)
+
+void caps_word_set_user(bool active) {
+    if (active) {
+        RGB color = {RGB_CYAN};
+        rgb_animation_breathe(CAPS_WORD_LED, color, 2000);
+    } else {
+        rgb_animation_stop(CAPS_WORD_LED);
+    }
+}
+#endif
+
+#ifdef RGB_STREAM_ENABLE
+// QMK hands every raw HID report to the keymap when neither Oryx nor VIA owns raw HID, rules.mk
+// refuses RGB_STREAM_ENABLE alongside ORYX_ENABLE
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    if (rgb_stream_receive(data, length)) {
+#    ifdef RGB_SCHEDULER_ENABLE
+        // A frame from the host is worth waking up for
+        rgb_scheduler_activity();
+#    endif
+    }
+}
+#endif
+
 bool rgb_matrix_indicators_user(void) {
+#ifdef RGB_SCHEDULER_ENABLE
+    if (!rgb_scheduler_render()) {
+        return true;
+    }
+#endif
+#ifdef RGB_HEATMAP_ENABLE
+    manage_heatmap();
+#endif
+#ifdef RGB_STREAM_ENABLE
+    manage_rgb_stream();
+#endif
     manage_blinking_keys();
+#ifdef RGB_ANIMATION_ENABLE
+    manage_animations();
+#endif
+#ifdef RGB_COMPOSITOR_ENABLE
+    rgb_compositor_compose();
+#endif
+    rgb_control_flush();
     return true;
 }
 
@@ -331,6 +417,9 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
     // dprintf("KL: kc: 0x%04X, col: %2u, row: %2u, pressed: %u, time: %5u, int: %u, count: %u\n",
     //         keycode, record->event.key.col, record->event.key.row, record->event.pressed,
     //         record->event.time, record->tap.interrupted, record->tap.count);
+#ifdef RGB_SCHEDULER_ENABLE
+    rgb_scheduler_activity();
+#endif
     keyrecord_t registered_record = {0};
     switch (keycode) {
         case RGB_CTRL_TOG:
@@ -382,14 +471,20 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
 
 uint8_t previous_active_oneshot_mods = 0;
 void    process_blinking_for_one_shot_mods(uint16_t keycode, keyrecord_t *record) {
-    uint8_t led_index = keypos_to_led_map[record->event.key.row][record->event.key.col];
+    // Combos come with a key position outside the matrix, and some positions have no LED
+    uint8_t led_index = UINT8_MAX;
+    if (record->event.key.row < MATRIX_ROWS && record->event.key.col < MATRIX_COLS) {
+        led_index = keypos_to_led_map[record->event.key.row][record->event.key.col];
+    }
     switch (keycode) {
         case OSM_ALT:
         case OSM_LSHIFT:
         case OSM_LCTRL:
             if (record->event.pressed) {
-                RGB rgb = {RGB_YELLOW};
-                enable_blinking_for(led_index, rgb, 500, UINT32_MAX);
+                if (led_index < RGB_MATRIX_LED_COUNT) {
+                    RGB rgb = {RGB_YELLOW};
+                    enable_blinking_for(led_index, rgb, 500, RGB_BLINK_FOREVER);
+                }
                 break;
             }
         default: {
@@ -409,9 +504,12 @@ void    process_blinking_for_one_shot_mods(uint16_t keycode, keyrecord_t *record
                                osm_led);
                     if ((active_oneshot_mods & checked_mod) == 0 &&
                         (previous_active_oneshot_mods & checked_mod) != 0) {
-                        RGB color = {0, 10, 100};
-                        enable_blinking_for(led_index, color, 2500, 3);
-                        enable_blinking_for(osm_led, color, 2500, 3);
+                        RGB      color = {0, 10, 100};
+                        uint64_t mask  = 1ULL << osm_led;
+                        if (led_index < RGB_MATRIX_LED_COUNT) {
+                            mask |= 1ULL << led_index;
+                        }
+                        enable_blinking_for_mask(mask, color, 2500, 3);
                     }
                 }
             }
@@ -426,6 +524,13 @@ void post_process_record_user(uint16_t keycode, keyrecord_t *record) {
     init_rgb_state();
     process_blinking_for_one_shot_mods(keycode, record);
 #endif
+#ifdef RGB_HEATMAP_ENABLE
+    // Combos come with a key position outside the matrix
+    if (record->event.pressed && record->event.key.row < MATRIX_ROWS &&
+        record->event.key.col < MATRIX_COLS) {
+        rgb_heatmap_hit(keypos_to_led_map[record->event.key.row][record->event.key.col]);
+    }
+#endif
 
     if (IS_QK_ONE_SHOT_MOD(keycode) && is_oneshot_layer_active() && record->event.pressed) {
         clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
@@ -477,65 +582,84 @@ uint8_t locked_mods = 0;
 
 void leader_compose_on_key_release_user(uint16_t keycode) {
     dprintln("leader compose on key release user");
-    if (keycode == KC_N && leader_compose_release_sequence_one_key(KC_N)) {
+    if (keycode == KC_N && leader_compose_release_sequence(KC_N)) {
         unregister_code(KC_BACKSPACE);
-    } else if (keycode == KC_R && leader_compose_release_sequence_two_keys(KC_SPACE, KC_R)) {
+    } else if (keycode == KC_R && leader_compose_release_sequence(KC_SPACE, KC_R)) {
         dprintln("R released");
         unregister_mods(MOD_BIT_LCTRL);
     }
 }
-void leader_compose_on_timeout_sequences(void) {
-    if (leader_compose_sequence_two_keys(KC_SPACE, KC_R)) {
-        register_mods(MOD_BIT_LCTRL);
-        locked_mods |= MOD_BIT_LCTRL;
-        set_last_mods(MOD_BIT_LCTRL);
-        leader_compose_register_sequence_held(KC_SPACE, KC_R, 0, 0, 0);
-    } else if (leader_compose_sequence_two_keys(KC_SPACE, KC_A)) {
-        register_mods(MOD_BIT_LALT);
-        locked_mods |= MOD_BIT_LALT;
-        set_last_mods(MOD_BIT_LALT);
-    } else {
-        clear_oneshot_locked_mods();
-        unregister_mods(locked_mods);
-        locked_mods = 0;
-    }
+void leader_compose_on_no_match_user(void) {
+    clear_oneshot_locked_mods();
+    unregister_mods(locked_mods);
+    locked_mods = 0;
 }
 
-bool leader_compose_final_sequences(void) {
-    // SHIFT
-    if (leader_compose_sequence_one_key(KC_S)) {
-        set_oneshot_mods(MOD_BIT_LSHIFT);
-        set_last_mods(MOD_BIT_LSHIFT);
-    } else if (leader_compose_sequence_two_keys(KC_SPACE, KC_S)) {
-        caps_word_toggle();
-    }
-    // CTRL
-    else if (leader_compose_sequence_one_key(KC_R)) {
-        set_oneshot_mods(MOD_BIT_LCTRL);
-        set_last_mods(MOD_BIT_LCTRL);
-    } // ALT
-    else if (leader_compose_sequence_one_key(KC_A)) {
-        set_oneshot_mods(MOD_BIT_LALT);
-        set_last_mods(MOD_BIT_LALT);
-    }
-    // Ctrl + Shift (avoiding accidental press on ctrl s or capital r)
-    else if (leader_compose_sequence_three_keys(KC_SPACE, KC_R, KC_S)) {
-        set_oneshot_mods(MOD_MASK_CS);
-        set_last_mods(MOD_MASK_CS);
-    }
-    // Ctrl + Alt (avoiding accidental press on ctrl a)
-    else if (leader_compose_sequence_three_keys(KC_SPACE, KC_R, KC_A)) {
-        set_oneshot_mods(MOD_MASK_CA);
-        set_last_mods(MOD_MASK_CA);
-    } else if (leader_compose_sequence_one_key(KC_T)) {
-        SEND_STRING(SS_TAP(X_TAB));
-        set_last_keycode(KC_TAB);
-    } else if (leader_compose_sequence_one_key(KC_N)) {
-        register_code(KC_BACKSPACE);
-        set_last_keycode(KC_BACKSPACE);
-        leader_compose_register_sequence_held(KC_N, 0, 0, 0, 0);
-    } else {
-        return false;
-    }
-    return true;
+// SHIFT
+void leader_oneshot_shift(void) {
+    set_oneshot_mods(MOD_BIT_LSHIFT);
+    set_last_mods(MOD_BIT_LSHIFT);
+}
+
+void leader_caps_word(void) {
+    caps_word_toggle();
+}
+
+// CTRL
+void leader_oneshot_ctrl(void) {
+    set_oneshot_mods(MOD_BIT_LCTRL);
+    set_last_mods(MOD_BIT_LCTRL);
+}
+
+void leader_lock_ctrl(void) {
+    register_mods(MOD_BIT_LCTRL);
+    locked_mods |= MOD_BIT_LCTRL;
+    set_last_mods(MOD_BIT_LCTRL);
+    leader_compose_register_sequence_held(KC_SPACE, KC_R);
 }
+
+// Undoes a speculative leader_lock_ctrl when the sequence turns out to be SPACE R S or SPACE R A
+void leader_unlock_ctrl(void) {
+    unregister_mods(MOD_BIT_LCTRL);
+    locked_mods &= ~MOD_BIT_LCTRL;
+    leader_compose_release_sequence(KC_SPACE, KC_R);
+}
+
+// ALT
+void leader_oneshot_alt(void) {
+    set_oneshot_mods(MOD_BIT_LALT);
+    set_last_mods(MOD_BIT_LALT);
+}
+
+void leader_lock_alt(void) {
+    register_mods(MOD_BIT_LALT);
+    locked_mods |= MOD_BIT_LALT;
+    set_last_mods(MOD_BIT_LALT);
+}
+
+// Ctrl + Shift (avoiding accidental press on ctrl s or capital r)
+void leader_oneshot_ctrl_shift(void) {
+    set_oneshot_mods(MOD_MASK_CS);
+    set_last_mods(MOD_MASK_CS);
+}
+
+// Ctrl + Alt (avoiding accidental press on ctrl a)
+void leader_oneshot_ctrl_alt(void) {
+    set_oneshot_mods(MOD_MASK_CA);
+    set_last_mods(MOD_MASK_CA);
+}
+
+void leader_tab(void) {
+    SEND_STRING(SS_TAP(X_TAB));
+    set_last_keycode(KC_TAB);
+}
+
+void leader_backspace(void) {
+    register_code(KC_BACKSPACE);
+    set_last_keycode(KC_BACKSPACE);
+    leader_compose_register_sequence_held(KC_N);
+}
+
+#ifdef LEADER_COMPOSE_ENABLE
+#    include "leader_compose_trie.h"
+#endif
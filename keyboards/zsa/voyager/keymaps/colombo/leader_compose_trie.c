@@ -0,0 +1,60 @@
+// Generated by features/leader_compose_trie.py from leader_sequences.def, do not edit.
+
+#include "leader_compose_trie.h"
+
+_Static_assert(3 <= LEADER_SEQUENCE_SIZE, "leader_sequences.def has sequences longer than LEADER_SEQUENCE_SIZE");
+_Static_assert(KC_A < LEADER_COMPOSE_KEY_OTHER, "KC_A does not fit a leader_compose key");
+_Static_assert(KC_N < LEADER_COMPOSE_KEY_OTHER, "KC_N does not fit a leader_compose key");
+_Static_assert(KC_R < LEADER_COMPOSE_KEY_OTHER, "KC_R does not fit a leader_compose key");
+_Static_assert(KC_S < LEADER_COMPOSE_KEY_OTHER, "KC_S does not fit a leader_compose key");
+_Static_assert(KC_SPACE < LEADER_COMPOSE_KEY_OTHER, "KC_SPACE does not fit a leader_compose key");
+_Static_assert(KC_T < LEADER_COMPOSE_KEY_OTHER, "KC_T does not fit a leader_compose key");
+
+// clang-format off
+const leader_compose_action_t PROGMEM leader_compose_actions[LEADER_COMPOSE_ACTION_COUNT] = {
+    leader_oneshot_shift,
+    leader_caps_word,
+    leader_oneshot_ctrl,
+    leader_lock_ctrl,
+    leader_oneshot_alt,
+    leader_lock_alt,
+    leader_oneshot_ctrl_shift,
+    leader_oneshot_ctrl_alt,
+    leader_tab,
+    leader_backspace,
+};
+
+#ifdef LEADER_COMPOSE_SPECULATIVE
+// Retracts a speculatively fired action, NULL when the action cannot be speculated
+const leader_compose_action_t PROGMEM leader_compose_undos[LEADER_COMPOSE_ACTION_COUNT] = {
+    NULL,
+    NULL,
+    NULL,
+    leader_unlock_ctrl,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+// Speculation confidence of every node
+uint8_t leader_compose_confidence[LEADER_COMPOSE_NODE_COUNT];
+#endif
+
+const leader_compose_node_t PROGMEM leader_compose_trie[LEADER_COMPOSE_NODE_COUNT] = {
+    /*   0 */ {1, LEADER_COMPOSE_NO_ACTION, KC_NO, 6},
+    /*   1 */ {0, 0, KC_S, 0}, // leader_oneshot_shift
+    /*   2 */ {7, LEADER_COMPOSE_NO_ACTION, KC_SPACE, 3},
+    /*   3 */ {0, 2, KC_R, 0}, // leader_oneshot_ctrl
+    /*   4 */ {0, 4, KC_A, 0}, // leader_oneshot_alt
+    /*   5 */ {0, 8, KC_T, 0}, // leader_tab
+    /*   6 */ {0, 9, KC_N, 0}, // leader_backspace
+    /*   7 */ {0, 1, KC_S, 0}, // leader_caps_word
+    /*   8 */ {10, 3, KC_R, 2}, // leader_lock_ctrl
+    /*   9 */ {0, 5, KC_A, 0}, // leader_lock_alt
+    /*  10 */ {0, 6, KC_S, 0}, // leader_oneshot_ctrl_shift
+    /*  11 */ {0, 7, KC_A, 0}, // leader_oneshot_ctrl_alt
+};
+// clang-format on
@@ -0,0 +1,38 @@
+// Generated by features/leader_compose_trie.py from leader_sequences.def, do not edit.
+
+#pragma once
+
+#include "features/leader_compose.h"
+
+#define LEADER_COMPOSE_ACTION_COUNT 10
+#define LEADER_COMPOSE_NODE_COUNT   12
+
+// clang-format off
+#define LEADER_COMPOSE_ACTIONS(X) \
+    X(leader_oneshot_shift) \
+    X(leader_caps_word) \
+    X(leader_oneshot_ctrl) \
+    X(leader_lock_ctrl) \
+    X(leader_oneshot_alt) \
+    X(leader_lock_alt) \
+    X(leader_oneshot_ctrl_shift) \
+    X(leader_oneshot_ctrl_alt) \
+    X(leader_tab) \
+    X(leader_backspace) \
+
+#define LEADER_COMPOSE_UNDOS(X) \
+    X(leader_unlock_ctrl) \
+
+// clang-format on
+
+#define LEADER_COMPOSE_DECLARE_ACTION(action) void action(void);
+LEADER_COMPOSE_ACTIONS(LEADER_COMPOSE_DECLARE_ACTION)
+LEADER_COMPOSE_UNDOS(LEADER_COMPOSE_DECLARE_ACTION)
+#undef LEADER_COMPOSE_DECLARE_ACTION
+
+extern const leader_compose_node_t   leader_compose_trie[LEADER_COMPOSE_NODE_COUNT];
+extern const leader_compose_action_t leader_compose_actions[LEADER_COMPOSE_ACTION_COUNT];
+#ifdef LEADER_COMPOSE_SPECULATIVE
+extern const leader_compose_action_t leader_compose_undos[LEADER_COMPOSE_ACTION_COUNT];
+extern uint8_t                       leader_compose_confidence[LEADER_COMPOSE_NODE_COUNT];
+#endif
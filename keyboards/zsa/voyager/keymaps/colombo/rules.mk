@@ -28,8 +28,49 @@ ifeq ($(strip $(RGB_CONTROL_ENABLE)), yes)
 	SRC += features/rgb_control.c
 endif
 
+RGB_COMPOSITOR_ENABLE = yes
+ifeq ($(strip $(RGB_COMPOSITOR_ENABLE)), yes)
+	OPT_DEFS += -DRGB_COMPOSITOR_ENABLE
+	SRC += features/rgb_compositor.c
+endif
+
+RGB_SCHEDULER_ENABLE = no
+ifeq ($(strip $(RGB_SCHEDULER_ENABLE)), yes)
+	OPT_DEFS += -DRGB_SCHEDULER_ENABLE
+	SRC += features/rgb_scheduler.c
+endif
+
+RGB_HEATMAP_ENABLE = no
+ifeq ($(strip $(RGB_HEATMAP_ENABLE)), yes)
+	OPT_DEFS += -DRGB_HEATMAP_ENABLE
+	SRC += features/rgb_heatmap.c
+endif
+
+RGB_STREAM_ENABLE = no
+ifeq ($(strip $(RGB_STREAM_ENABLE)), yes)
+	# Oryx implements raw_hid_receive itself, the stream needs it for its reports
+	ifeq ($(strip $(ORYX_ENABLE)), yes)
+        $(error RGB_STREAM_ENABLE needs raw HID to itself, set ORYX_ENABLE = no)
+	endif
+	RAW_ENABLE = yes
+	OPT_DEFS += -DRGB_STREAM_ENABLE
+	SRC += features/rgb_stream.c
+endif
+
+RGB_ANIMATION_ENABLE = no
+ifeq ($(strip $(RGB_ANIMATION_ENABLE)), yes)
+	OPT_DEFS += -DRGB_ANIMATION_ENABLE
+	SRC += features/rgb_animation.c
+endif
+
 LEADER_COMPOSE_ENABLE = no
 ifeq ($(strip $(LEADER_COMPOSE_ENABLE)), yes)
 	OPT_DEFS += -DLEADER_COMPOSE_ENABLE
-	SRC += features/leader_compose.c
+	SRC += features/leader_compose.c leader_compose_trie.c
+	# leader_compose_trie.{c,h} follow leader_sequences.def, the generator only rewrites them on change
+	LEADER_COMPOSE_TRIE := $(shell python3 $(ROOT_DIR)../../../../../features/leader_compose_trie.py \
+		$(ROOT_DIR)leader_sequences.def 2>&1)
+	ifneq ($(.SHELLSTATUS), 0)
+        $(error $(LEADER_COMPOSE_TRIE))
+	endif
 endif
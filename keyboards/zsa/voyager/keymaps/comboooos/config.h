@@ -17,4 +17,11 @@
 
 #define RGB_MATRIX_STARTUP_SPD 60
 
+// A layer switch recolors every LED, spread it over two indicator frames
+#define RGB_COMPOSITOR_LED_BUDGET 26
+
+// Caps the estimated draw on bus-powered hubs, above the brightest ledmap layer at full brightness
+// (about 920 mA) so the layer colors are never dimmed
+#define RGB_POWER_BUDGET_MA 1000
+
 #include "config_comboooos.h"
@@ -1,6 +1,10 @@
 #include QMK_KEYBOARD_H
 #include "voyager.h"
 #include "i18n.h"
+#include "features/rgb_compositor.h"
+#include "features/rgb_control.h"
+#include "features/rgb_scheduler.h"
+#include "ledmap_frames.h"
 #include "comboooos.c"
 
 #define MOON_LED_LEVEL LED_LEVEL
@@ -58,87 +62,73 @@ void keyboard_post_init_user(void) {
     rgb_matrix_enable();
 }
 
-const uint8_t PROGMEM ledmap[][RGB_MATRIX_LED_COUNT][3] = {
-    [0] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {119, 240, 192}, {72, 240, 198}, {39, 247, 255}, {0, 218, 204}, {157, 218, 204}, {0, 0, 0}, {212, 218, 204}, {212, 218, 204}, {212, 218, 204}, {212, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {0, 218, 204}, {39, 247, 255}, {72, 240, 198}, {119, 240, 192}, {0, 0, 0}, {0, 0, 0}, {211, 218, 204}, {212, 218, 204}, {212, 218, 204}, {212, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
+// The base plane no longer holds the colors of the current layer
+bool    layer_indicator_dirty  = true;
+uint8_t layer_frame_brightness = 0;
 
-    [1] = {{0, 0, 0}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
+// Paints the layer colors scaled by the RGB matrix brightness on the base plane
+void set_layer_color(uint8_t layer) {
+    uint8_t brightness     = rgb_matrix_config.hsv.v;
+    layer_frame_brightness = brightness;
 
-    [2] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 0, 0}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 218, 204}, {0, 0, 0}, {0, 213, 199}, {0, 0, 255}, {0, 0, 255}},
-
-    [3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
-
-    [4] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {39, 247, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
-
-    [5] = {{0, 0, 0}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {72, 240, 198}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {0, 0, 0}, {72, 240, 198}, {72, 240, 198}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
-
-    [6] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {119, 240, 192}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
-
-    [7] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {157, 218, 204}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
+    RGB palette[LEDMAP_PALETTE_COUNT];
+    for (uint8_t color = 0; color < LEDMAP_PALETTE_COUNT; color++) {
+        palette[color].r = pgm_read_byte(&ledmap_palette[color][0]) * brightness / UINT8_MAX;
+        palette[color].g = pgm_read_byte(&ledmap_palette[color][1]) * brightness / UINT8_MAX;
+        palette[color].b = pgm_read_byte(&ledmap_palette[color][2]) * brightness / UINT8_MAX;
+    }
+    for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+        uint8_t pair  = pgm_read_byte(&ledmap_indices[layer][i / 2]);
+        uint8_t color = (i & 1) ? pair >> 4 : pair & 0x0F;
+        rgb_compositor_set(RGB_PLANE_BASE, i, palette[color], UINT8_MAX);
+    }
+}
 
-    [8] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {157, 218, 204}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {157, 218, 204}, {157, 218, 204}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 255}, {0, 0, 255}},
+layer_state_t layer_state_set_user(layer_state_t state) {
+    if (biton32(state) != biton32(layer_state)) {
+        layer_indicator_dirty = true;
+    }
+    return state;
+}
 
-};
+void suspend_wakeup_init_user(void) {
+    rgb_scheduler_resume();
+}
 
-void set_layer_color(int layer) {
-    for (int i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
-        HSV hsv = {
-            .h = pgm_read_byte(&ledmap[layer][i][0]),
-            .s = pgm_read_byte(&ledmap[layer][i][1]),
-            .v = pgm_read_byte(&ledmap[layer][i][2]),
-        };
-        if (!hsv.h && !hsv.s && !hsv.v) {
-            rgb_matrix_set_color(i, 0, 0, 0);
-        } else {
-            RGB   rgb = hsv_to_rgb(hsv);
-            float f   = (float)rgb_matrix_config.hsv.v / UINT8_MAX;
-            rgb_matrix_set_color(i, f * rgb.r, f * rgb.g, f * rgb.b);
-        }
-    }
+void suspend_power_down_user(void) {
+    rgb_scheduler_suspend();
 }
 
 bool rgb_matrix_indicators_user(void) {
-    if (rawhid_state.rgb_control) {
+    if (rawhid_state.rgb_control || keyboard_config.disable_layer_led) {
+        // Oryx paints the LEDs itself, or nothing should. The planes are kept for when it stops
+        rgb_control_invalidate();
         return false;
     }
-    if (keyboard_config.disable_layer_led) {
-        return false;
+    if (!rgb_scheduler_render()) {
+        return true;
     }
-    switch (biton32(layer_state)) {
-        case 0:
-            set_layer_color(0);
-            break;
-        case 1:
-            set_layer_color(1);
-            break;
-        case 2:
-            set_layer_color(2);
-            break;
-        case 3:
-            set_layer_color(3);
-            break;
-        case 4:
-            set_layer_color(4);
-            break;
-        case 5:
-            set_layer_color(5);
-            break;
-        case 6:
-            set_layer_color(6);
-            break;
-        case 7:
-            set_layer_color(7);
-            break;
-        case 8:
-            set_layer_color(8);
-            break;
-        default:
-            if (rgb_matrix_get_flags() == LED_FLAG_NONE) rgb_matrix_set_color_all(0, 0, 0);
-            break;
+    if (layer_indicator_dirty || rgb_matrix_config.hsv.v != layer_frame_brightness) {
+        uint8_t layer = biton32(layer_state);
+        if (layer < LEDMAP_LAYER_COUNT) {
+            set_layer_color(layer);
+        } else if (rgb_matrix_get_flags() == LED_FLAG_NONE) {
+            RGB off = {0, 0, 0};
+            for (uint8_t i = 0; i < RGB_MATRIX_LED_COUNT; i++) {
+                rgb_compositor_set(RGB_PLANE_BASE, i, off, UINT8_MAX);
+            }
+        } else {
+            rgb_compositor_clear_plane(RGB_PLANE_BASE);
+        }
+        layer_indicator_dirty = false;
     }
+    rgb_compositor_compose();
+    rgb_control_flush();
     return true;
 }
 
 bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    rgb_scheduler_activity();
     switch (keycode) {
         case RGB_SLD:
             if (record->event.pressed) {
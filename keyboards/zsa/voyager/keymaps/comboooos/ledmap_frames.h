@@ -0,0 +1,40 @@
+// Generated by features/ledmap_frames.py from ledmap.def, do not edit.
+
+#pragma once
+
+#include <stdint.h>
+#include "progmem.h"
+
+#define LEDMAP_LAYER_COUNT   9
+#define LEDMAP_LED_COUNT     52
+#define LEDMAP_PALETTE_COUNT 10
+
+_Static_assert(LEDMAP_LED_COUNT == RGB_MATRIX_LED_COUNT, "ledmap.def does not have a color for every LED");
+
+// clang-format off
+const uint8_t PROGMEM ledmap_palette[LEDMAP_PALETTE_COUNT][3] = {
+    {0, 0, 0},
+    {11, 192, 156},
+    {69, 198, 11},
+    {255, 234, 7},
+    {204, 30, 29},
+    {29, 83, 204},
+    {201, 29, 204},
+    {255, 255, 255},
+    {197, 29, 204},
+    {199, 33, 32},
+};
+
+// Palette index of every LED, the even LED of each pair in the low nibble
+const uint8_t PROGMEM ledmap_indices[LEDMAP_LAYER_COUNT][(LEDMAP_LED_COUNT + 1) / 2] = {
+    [0] = {0x00, 0x00, 0x00, 0x10, 0x32, 0x54, 0x60, 0x66, 0x06, 0x00, 0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x45, 0x23, 0x01, 0x80, 0x66, 0x06, 0x00, 0x00, 0x00, 0x77},
+    [1] = {0x40, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x77, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77},
+    [2] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77, 0x44, 0x44, 0x04, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x90, 0x77},
+    [3] = {0x00, 0x00, 0x30, 0x00, 0x33, 0x33, 0x00, 0x33, 0x33, 0x00, 0x33, 0x33, 0x77, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77},
+    [4] = {0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77, 0x03, 0x00, 0x03, 0x33, 0x33, 0x00, 0x33, 0x33, 0x00, 0x33, 0x33, 0x00, 0x77},
+    [5] = {0x00, 0x22, 0x22, 0x20, 0x22, 0x22, 0x20, 0x22, 0x22, 0x00, 0x20, 0x02, 0x77, 0x02, 0x00, 0x00, 0x22, 0x22, 0x00, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77},
+    [6] = {0x00, 0x00, 0x00, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x77},
+    [7] = {0x00, 0x00, 0x00, 0x00, 0x55, 0x05, 0x00, 0x55, 0x00, 0x00, 0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77},
+    [8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x50, 0x55, 0x00, 0x00, 0x55, 0x00, 0x00, 0x00, 0x00, 0x77},
+};
+// clang-format on
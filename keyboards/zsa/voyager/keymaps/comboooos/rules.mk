@@ -7,3 +7,21 @@ ROOT_DIR := $(dir $(realpath $(lastword $(MAKEFILE_LIST))))
 include ${ROOT_DIR}../../../../../rules.mk
 ORYX_ENABLE = yes
 RGB_MATRIX_CUSTOM_KB = yes
+
+RGB_CONTROL_ENABLE = yes
+ifeq ($(strip $(RGB_CONTROL_ENABLE)), yes)
+	OPT_DEFS += -DRGB_CONTROL_ENABLE
+	SRC += features/rgb_control.c
+endif
+
+RGB_COMPOSITOR_ENABLE = yes
+ifeq ($(strip $(RGB_COMPOSITOR_ENABLE)), yes)
+	OPT_DEFS += -DRGB_COMPOSITOR_ENABLE
+	SRC += features/rgb_compositor.c
+endif
+
+RGB_SCHEDULER_ENABLE = yes
+ifeq ($(strip $(RGB_SCHEDULER_ENABLE)), yes)
+	OPT_DEFS += -DRGB_SCHEDULER_ENABLE
+	SRC += features/rgb_scheduler.c
+endif